@@ -30,9 +30,17 @@
 #include "qorganizer-eds-enginedata.h"
 #include "qorganizer-eds-source-registry.h"
 #include "qorganizer-eds-parseeventthread.h"
+#include "qorganizer-eds-iothread.h"
+#include "qorganizer-eds-requestscheduler.h"
+#include "qorganizer-eds-sharedfetch.h"
+#include "qorganizer-eds-instancecache.h"
+#include "qorganizer-eds-prefetcher.h"
+#include "qorganizer-eds-timezonecache.h"
+#include "qorganizer-eds-itemidpool.h"
 
 #include <QtCore/qdebug.h>
 #include <QtCore/QPointer>
+#include <QtCore/QThread>
 #include <QtCore/QTimeZone>
 
 #include <QtOrganizer/QOrganizerEventAttendee>
@@ -64,23 +72,36 @@
 #include <glib.h>
 #include <libecal/libecal.h>
 #include <libical/ical.h>
+#include <string.h>
 
 using namespace QtOrganizer;
 QOrganizerEDSEngineData *QOrganizerEDSEngine::m_globalData = 0;
 
 QOrganizerEDSEngine* QOrganizerEDSEngine::createEDSEngine(const QMap<QString, QString>& parameters)
 {
-    Q_UNUSED(parameters);
     if (!m_globalData) {
         m_globalData = new QOrganizerEDSEngineData();
         m_globalData->m_sourceRegistry = new SourceRegistry;
+        m_globalData->m_watchIdsOnly = (parameters.value(EDS_WATCHER_MODE_PARAMETER) == QStringLiteral("ids"));
+        m_globalData->m_watchWindow = qMax(0, parameters.value(EDS_WATCHER_WINDOW_PARAMETER).toInt());
+        // the prefetched instances are only kept when every change is watched
+        if ((parameters.value(EDS_PREFETCH_PARAMETER) == QStringLiteral("true")) &&
+            (m_globalData->m_watchWindow == 0)) {
+            m_globalData->m_prefetcher = new Prefetcher;
+        }
     }
     m_globalData->m_refCount.ref();
-    return new QOrganizerEDSEngine(m_globalData);
+
+    // only this manager asked for the periods, the others sharing the data
+    // keep getting the events
+    QOrganizerEDSEngine *engine = new QOrganizerEDSEngine(m_globalData);
+    engine->m_freeBusy = (parameters.value(EDS_FREE_BUSY_PARAMETER) == QStringLiteral("true"));
+    return engine;
 }
 
 QOrganizerEDSEngine::QOrganizerEDSEngine(QOrganizerEDSEngineData *data)
-    : d(data)
+    : d(data),
+      m_freeBusy(false)
 {
     d->m_sharedEngines << this;
 
@@ -98,9 +119,15 @@ QOrganizerEDSEngine::QOrganizerEDSEngine(QOrganizerEDSEngineData *data)
 
 QOrganizerEDSEngine::~QOrganizerEDSEngine()
 {
+    // the other engines keep the fetches started here
+    Q_FOREACH(SharedFetch *shared, d->m_sharedFetches.values()) {
+        shared->engineDestroyed(this);
+    }
+
     while(m_runningRequests.count()) {
         QOrganizerAbstractRequest *req = m_runningRequests.keys().first();
-        req->cancel();
+        // shared fetches run requests not started by any manager
+        cancelRequest(req);
         QOrganizerEDSEngine::requestDestroyed(req);
     }
 
@@ -117,13 +144,68 @@ QString QOrganizerEDSEngine::managerName() const
 }
 
 void QOrganizerEDSEngine::itemsAsync(QOrganizerItemFetchRequest *req)
+{
+    if (d->m_prefetcher && req->startDate().isValid() && req->endDate().isValid()) {
+        d->m_prefetcher->cancelOutside(req->startDate(), req->endDate());
+    }
+
+    QByteArray key = SharedFetch::key(this, req);
+    QList<QOrganizerItem> items;
+    if (d->fetchResults(key, requestSourceIds(req), &items)) {
+        // nothing changed since the same fetch finished, the results are
+        // delivered from the request context like any other
+        FetchSubscriberData *data = new FetchSubscriberData(this, req, 0);
+        data->setResults(items);
+        QOrganizerEDSIOThread::invoke(data->context(),
+                                      (GSourceFunc) QOrganizerEDSEngine::itemsAsyncCached,
+                                      data);
+        return;
+    }
+
+    if (m_syncRequests.contains(req)) {
+        // synchronous calls can not wait for somebody else's fetch
+        itemsAsyncFetch(req);
+        return;
+    }
+
+    // identical requests in flight share the same fetch, whichever engine
+    // started it
+    SharedFetch *shared = d->m_sharedFetches.value(key);
+    if (shared) {
+        shared->subscribe(this, req);
+        return;
+    }
+
+    shared = new SharedFetch(this, key, req);
+    d->m_sharedFetches.insert(key, shared);
+    shared->subscribe(this, req);
+    shared->start();
+}
+
+gboolean QOrganizerEDSEngine::itemsAsyncCached(FetchSubscriberData *data)
+{
+    // check if request was destroyed by the caller
+    if (!data->isLive()) {
+        releaseRequestData(data);
+        return FALSE;
+    }
+
+    data->finish();
+    return FALSE;
+}
+
+void QOrganizerEDSEngine::itemsAsyncFetch(QOrganizerItemFetchRequest *req, bool prefetch)
 {
     FetchRequestData *data = new FetchRequestData(this,
                                                   d->m_sourceRegistry->sourceIds(),
                                                   req);
+    data->setPrefetch(prefetch);
     // avoid query if the filter is invalid
     if (data->filterIsValid()) {
-        itemsAsyncStart(data);
+        d->m_scheduler->submit(data,
+                               data->priority(),
+                               requestSourceIds(req),
+                               (RequestScheduler::StartFunction) QOrganizerEDSEngine::itemsAsyncStart);
     } else {
         data->finish();
     }
@@ -137,40 +219,107 @@ void QOrganizerEDSEngine::itemsAsyncStart(FetchRequestData *data)
         return;
     }
 
+    SourceRegistry *registry = data->parent()->d->m_sourceRegistry;
+    if (data->allSourcesConnecting()) {
+        // nothing to do until one of the backends is ready
+        data->setClientReadyConnection(QObject::connect(registry, &SourceRegistry::clientReady,
+                                                        [data](const QByteArray &) {
+            data->setClientReadyConnection(QMetaObject::Connection());
+            itemsAsyncStart(data);
+        }));
+        return;
+    }
+
     QByteArray sourceId = data->nextSourceId();
     if (!sourceId.isEmpty()) {
-        EClient *client = data->parent()->d->m_sourceRegistry->client(sourceId);
+        EClient *client = 0;
+        if (registry->clientState(sourceId) != SourceRegistry::ClientFailed) {
+            client = registry->client(sourceId);
+        }
+        if (!client) {
+            qWarning() << "Fail to connect with collection" << sourceId;
+            itemsAsyncStart(data);
+            return;
+        }
         data->setClient(client);
         g_object_unref(client);
 
-        if (data->hasDateInterval()) {
-            e_cal_client_generate_instances(data->client(),
-                                            data->startDate(),
-                                            data->endDate(),
-                                            data->cancellable(),
-                                            (ECalRecurInstanceFn) QOrganizerEDSEngine::itemsAsyncListed,
-                                            data,
-                                            (GDestroyNotify) QOrganizerEDSEngine::itemsAsyncDone);
-        } else {
-            // if no date interval was set we return only the main events without recurrence
-            e_cal_client_get_object_list_as_comps(E_CAL_CLIENT(client),
-                                                  data->dateFilter().toUtf8().data(),
-                                                  data->cancellable(),
-                                                  (GAsyncReadyCallback) QOrganizerEDSEngine::itemsAsyncListedAsComps,
-                                                  data);
-        }
+        // list on the I/O thread, expanding the recurrences and copying the
+        // components does not compete with the main loop
+        data->setListing(true);
+        data->parent()->d->m_ioThread->invoke((GSourceFunc) QOrganizerEDSEngine::itemsAsyncList, data);
     } else {
         data->finish();
     }
 }
 
+gboolean QOrganizerEDSEngine::itemsAsyncList(FetchRequestData *data)
+{
+    if (g_cancellable_is_cancelled(data->cancellable())) {
+        QOrganizerEDSIOThread::invoke(data->context(), (GSourceFunc) QOrganizerEDSEngine::itemsAsyncListDone, data);
+    } else if (data->listInterval()) {
+        data->planGaps();
+        itemsAsyncListGap(data);
+    } else {
+        // if no date interval was set we return only the main events without recurrence
+        e_cal_client_get_object_list(data->client(),
+                                     data->listQuery().constData(),
+                                     data->cancellable(),
+                                     (GAsyncReadyCallback) QOrganizerEDSEngine::itemsAsyncListedObjects,
+                                     data);
+    }
+    return FALSE;
+}
+
+void QOrganizerEDSEngine::itemsAsyncListGap(FetchRequestData *data)
+{
+    if (data->nextGap()) {
+        e_cal_client_generate_instances(data->client(),
+                                        data->gapStart(),
+                                        data->gapEnd(),
+                                        data->cancellable(),
+                                        (ECalRecurInstanceFn) QOrganizerEDSEngine::itemsAsyncListed,
+                                        data,
+                                        (GDestroyNotify) QOrganizerEDSEngine::itemsAsyncDone);
+    } else {
+        // the rest of the range comes from the instance cache
+        data->mergeGaps();
+        QOrganizerEDSIOThread::invoke(data->context(), (GSourceFunc) QOrganizerEDSEngine::itemsAsyncListDone, data);
+    }
+}
+
+gboolean QOrganizerEDSEngine::itemsAsyncListDone(FetchRequestData *data)
+{
+    // back on the request thread, check if request was destroyed by the caller
+    data->setListing(false);
+    if (!data->isLive()) {
+        releaseRequestData(data);
+        return FALSE;
+    }
+
+    if (data->isPreempted()) {
+        // an interactive request needed the backend, try again later
+        data->rewindSource();
+        data->parent()->d->m_scheduler->requeue(data);
+        return FALSE;
+    }
+
+    if (data->listError() != QOrganizerManager::NoError) {
+        data->finish(data->listError());
+        return FALSE;
+    }
+
+    itemsAsyncStart(data);
+    return FALSE;
+}
+
 void QOrganizerEDSEngine::itemsAsyncDone(FetchRequestData *data)
 {
-    if (data->isLive()) {
+    if (g_cancellable_is_cancelled(data->cancellable())) {
+        QOrganizerEDSIOThread::invoke(data->context(), (GSourceFunc) QOrganizerEDSEngine::itemsAsyncListDone, data);
+    } else {
         data->compileCurrentIds();
         itemsAsyncFetchDeatachedItems(data);
-    } else {
-        releaseRequestData(data);
     }
 }
 
@@ -184,7 +333,8 @@ void QOrganizerEDSEngine::itemsAsyncFetchDeatachedItems(FetchRequestData *data)
                                          (GAsyncReadyCallback) QOrganizerEDSEngine::itemsAsyncListByIdListed,
                                          data);
     } else {
-        itemsAsyncStart(data);
+        data->storeGap();
+        itemsAsyncListGap(data);
     }
 }
 
@@ -203,11 +353,8 @@ void QOrganizerEDSEngine::itemsAsyncListByIdListed(GObject *source,
         qWarning() << "Fail to list deatached events in calendar" << gError->message;
         g_error_free(gError);
         gError = 0;
-        if (data->isLive()) {
-            data->finish(QOrganizerManager::InvalidCollectionError);
-        } else {
-            releaseRequestData(data);
-        }
+        data->setListError(QOrganizerManager::InvalidCollectionError);
+        QOrganizerEDSIOThread::invoke(data->context(), (GSourceFunc) QOrganizerEDSEngine::itemsAsyncListDone, data);
         return;
     }
 
@@ -215,6 +362,7 @@ void QOrganizerEDSEngine::itemsAsyncListByIdListed(GObject *source,
         icalcomponent * ical = e_cal_component_get_icalcomponent(static_cast<ECalComponent*>(e->data));
         data->appendDeatachedResult(ical);
     }
+    g_slist_free_full(events, (GDestroyNotify) g_object_unref);
 
     itemsAsyncFetchDeatachedItems(data);
 }
@@ -225,61 +373,54 @@ gboolean QOrganizerEDSEngine::itemsAsyncListed(ECalComponent *comp,
                                                time_t instanceEnd,
                                                FetchRequestData *data)
 {
-    Q_UNUSED(instanceStart);
-    Q_UNUSED(instanceEnd);
+    if (!g_cancellable_is_cancelled(data->cancellable())) {
+        if (data->isFreeBusy()) {
+            // only the times are needed
+            if (InstanceCache::isBusy(e_cal_component_get_icalcomponent(comp))) {
+                data->appendBusySpan(instanceStart, instanceEnd);
+            }
+            return TRUE;
+        }
 
-    if (data->isLive()) {
         icalcomponent *icalComp = icalcomponent_new_clone(e_cal_component_get_icalcomponent(comp));
         if (icalComp) {
-            data->appendResult(icalComp);
+            data->appendInstance(icalComp, instanceStart, instanceEnd);
         }
         return TRUE;
     }
     return FALSE;
 }
 
-void QOrganizerEDSEngine::itemsAsyncListedAsComps(GObject *source,
+void QOrganizerEDSEngine::itemsAsyncListedObjects(GObject *source,
                                                   GAsyncResult *res,
                                                   FetchRequestData *data)
 {
     Q_UNUSED(source);
     GError *gError = 0;
     GSList *events = 0;
-    e_cal_client_get_object_list_as_comps_finish(E_CAL_CLIENT(data->client()),
-                                                 res,
-                                                 &events,
-                                                 &gError);
+    e_cal_client_get_object_list_finish(E_CAL_CLIENT(data->client()),
+                                        res,
+                                        &events,
+                                        &gError);
     if (gError) {
         qWarning() << "Fail to list events in calendar" << gError->message;
         g_error_free(gError);
         gError = 0;
-        if (data->isLive()) {
-            data->finish(QOrganizerManager::InvalidCollectionError);
-        } else {
-            releaseRequestData(data);
-        }
-        return;
-    }
-
-    // check if request was destroyed by the caller
-    if (data->isLive()) {
-        QOrganizerItemFetchRequest *req = data->request<QOrganizerItemFetchRequest>();
-        if (req) {
-            data->appendResults(data->parent()->parseEvents(data->sourceId(),
-                                                            events,
-                                                            false,
-                                                            req->fetchHint().detailTypesHint()));
-        }
-        itemsAsyncStart(data);
+        data->setListError(QOrganizerManager::InvalidCollectionError);
     } else {
-        releaseRequestData(data);
+        // parsed with the other sources once the listing is done
+        data->appendResults(events);
     }
+    QOrganizerEDSIOThread::invoke(data->context(), (GSourceFunc) QOrganizerEDSEngine::itemsAsyncListDone, data);
 }
 
 void QOrganizerEDSEngine::itemsByIdAsync(QOrganizerItemFetchByIdRequest *req)
 {
     FetchByIdRequestData *data = new FetchByIdRequestData(this, req);
-    itemsByIdAsyncStart(data);
+    d->m_scheduler->submit(data,
+                           RequestScheduler::Interactive,
+                           requestSourceIds(req),
+                           (RequestScheduler::StartFunction) QOrganizerEDSEngine::itemsByIdAsyncStart);
 }
 
 void QOrganizerEDSEngine::itemsByIdAsyncStart(FetchByIdRequestData *data)
@@ -441,22 +582,20 @@ QList<QOrganizerItem> QOrganizerEDSEngine::items(const QList<QOrganizerItemId> &
                                                  QMap<int, QOrganizerManager::Error> *errorMap,
                                                  QOrganizerManager::Error *error)
 {
-    QOrganizerItemFetchByIdRequest *req = new QOrganizerItemFetchByIdRequest(this);
-    req->setIds(itemIds);
-    req->setFetchHint(fetchHint);
+    QOrganizerItemFetchByIdRequest req;
+    req.setIds(itemIds);
+    req.setFetchHint(fetchHint);
 
-    startRequest(req);
-    waitForRequestFinished(req, 0);
+    runRequestSync(&req);
 
     if (error) {
-        *error = req->error();
+        *error = req.error();
     }
 
     if (errorMap) {
-        *errorMap = req->errorMap();
+        *errorMap = req.errorMap();
     }
-    req->deleteLater();
-    return req->items();
+    return req.items();
 }
 
 QList<QOrganizerItem> QOrganizerEDSEngine::items(const QOrganizerItemFilter &filter,
@@ -467,24 +606,22 @@ QList<QOrganizerItem> QOrganizerEDSEngine::items(const QOrganizerItemFilter &fil
                                                  const QOrganizerItemFetchHint &fetchHint,
                                                  QOrganizerManager::Error *error)
 {
-    QOrganizerItemFetchRequest *req = new QOrganizerItemFetchRequest(this);
+    QOrganizerItemFetchRequest req;
 
-    req->setFilter(filter);
-    req->setStartDate(startDateTime);
-    req->setEndDate(endDateTime);
-    req->setMaxCount(maxCount);
-    req->setSorting(sortOrders);
-    req->setFetchHint(fetchHint);
+    req.setFilter(filter);
+    req.setStartDate(startDateTime);
+    req.setEndDate(endDateTime);
+    req.setMaxCount(maxCount);
+    req.setSorting(sortOrders);
+    req.setFetchHint(fetchHint);
 
-    startRequest(req);
-    waitForRequestFinished(req, 0);
+    runRequestSync(&req);
 
     if (error) {
-        *error = req->error();
+        *error = req.error();
     }
 
-    req->deleteLater();
-    return req->items();
+    return req.items();
 }
 
 QList<QOrganizerItemId> QOrganizerEDSEngine::itemIds(const QOrganizerItemFilter &filter,
@@ -508,23 +645,21 @@ QList<QOrganizerItem> QOrganizerEDSEngine::itemOccurrences(const QOrganizerItem
                                                            const QOrganizerItemFetchHint &fetchHint,
                                                            QOrganizerManager::Error *error)
 {
-    QOrganizerItemOccurrenceFetchRequest *req = new QOrganizerItemOccurrenceFetchRequest(this);
+    QOrganizerItemOccurrenceFetchRequest req;
 
-    req->setParentItem(parentItem);
-    req->setStartDate(startDateTime);
-    req->setEndDate(endDateTime);
-    req->setMaxOccurrences(maxCount);
-    req->setFetchHint(fetchHint);
+    req.setParentItem(parentItem);
+    req.setStartDate(startDateTime);
+    req.setEndDate(endDateTime);
+    req.setMaxOccurrences(maxCount);
+    req.setFetchHint(fetchHint);
 
-    startRequest(req);
-    waitForRequestFinished(req, 0);
+    runRequestSync(&req);
 
     if (error) {
-        *error = req->error();
+        *error = req.error();
     }
 
-    req->deleteLater();
-    return req->itemOccurrences();
+    return req.itemOccurrences();
 }
 
 QList<QOrganizerItem> QOrganizerEDSEngine::itemsForExport(const QDateTime &startDateTime,
@@ -736,16 +871,15 @@ bool QOrganizerEDSEngine::saveItems(QList<QtOrganizer::QOrganizerItem> *items,
                                     QtOrganizer::QOrganizerManager::Error *error)
 
 {
-    QOrganizerItemSaveRequest *req = new QOrganizerItemSaveRequest(this);
-    req->setItems(*items);
-    req->setDetailMask(detailMask);
+    QOrganizerItemSaveRequest req;
+    req.setItems(*items);
+    req.setDetailMask(detailMask);
 
-    startRequest(req);
-    waitForRequestFinished(req, 0);
+    runRequestSync(&req);
 
-    *errorMap = req->errorMap();
-    *error = req->error();
-    *items = req->items();
+    *errorMap = req.errorMap();
+    *error = req.error();
+    *items = req.items();
 
     return (*error == QOrganizerManager::NoError);
 }
@@ -835,19 +969,18 @@ bool QOrganizerEDSEngine::removeItems(const QList<QOrganizerItemId> &itemIds,
                                       QMap<int, QOrganizerManager::Error> *errorMap,
                                       QOrganizerManager::Error *error)
 {
-    QOrganizerItemRemoveByIdRequest *req = new QOrganizerItemRemoveByIdRequest(this);
-    req->setItemIds(itemIds);
-    startRequest(req);
-    waitForRequestFinished(req, 0);
+    QOrganizerItemRemoveByIdRequest req;
+    req.setItemIds(itemIds);
+    runRequestSync(&req);
 
     if (errorMap) {
-        *errorMap = req->errorMap();
+        *errorMap = req.errorMap();
     }
     if (error) {
-        *error = req->error();
+        *error = req.error();
     }
 
-    return (*error == QOrganizerManager::NoError);
+    return (req.error() == QOrganizerManager::NoError);
 }
 
 QOrganizerCollectionId QOrganizerEDSEngine::defaultCollectionId() const
@@ -873,34 +1006,25 @@ QList<QOrganizerCollection> QOrganizerEDSEngine::collections(QOrganizerManager::
 
 QList<QOrganizerCollection> QOrganizerEDSEngine::collections(QOrganizerManager::Error* error)
 {
-    QOrganizerCollectionFetchRequest *req = new QOrganizerCollectionFetchRequest(this);
-
-    startRequest(req);
-    waitForRequestFinished(req, 0);
-
+    // the collection fetch request finishes synchronously with the registry
+    // contents, read them directly instead of running a request
     if (error) {
-        *error = req->error();
-    }
-
-    if (req->error() == QOrganizerManager::NoError) {
-        return req->collections();
-    } else {
-        return QList<QOrganizerCollection>();
+        *error = QOrganizerManager::NoError;
     }
+    return d->m_sourceRegistry->collections();
 }
 
 bool QOrganizerEDSEngine::saveCollection(QOrganizerCollection* collection, QOrganizerManager::Error* error)
 {
-    QOrganizerCollectionSaveRequest *req = new QOrganizerCollectionSaveRequest(this);
-    req->setCollection(*collection);
+    QOrganizerCollectionSaveRequest req;
+    req.setCollection(*collection);
 
-    startRequest(req);
-    waitForRequestFinished(req, 0);
+    runRequestSync(&req);
 
-    *error = req->error();
+    *error = req.error();
     if ((*error == QOrganizerManager::NoError) &&
-        (req->collections().count())) {
-        *collection = req->collections()[0];
+        (req.collections().count())) {
+        *collection = req.collections()[0];
         return true;
     } else {
         return false;
@@ -1000,17 +1124,16 @@ void QOrganizerEDSEngine::saveCollectionUpdateAsynCommited(ESource *source,
 
 bool QOrganizerEDSEngine::removeCollection(const QOrganizerCollectionId& collectionId, QOrganizerManager::Error* error)
 {
-    QOrganizerCollectionRemoveRequest *req = new QOrganizerCollectionRemoveRequest(this);
-    req->setCollectionId(collectionId);
+    QOrganizerCollectionRemoveRequest req;
+    req.setCollectionId(collectionId);
 
-    startRequest(req);
-    waitForRequestFinished(req, 0);
+    runRequestSync(&req);
 
     if (error) {
-        *error = req->error();
+        *error = req.error();
     }
 
-    return(req->error() == QOrganizerManager::NoError);
+    return(req.error() == QOrganizerManager::NoError);
 }
 
 void QOrganizerEDSEngine::removeCollectionAsync(QtOrganizer::QOrganizerCollectionRemoveRequest *req)
@@ -1112,6 +1235,87 @@ bool QOrganizerEDSEngine::startRequest(QOrganizerAbstractRequest* req)
     if (!req)
         return false;
 
+    prepareRequest(req);
+    dispatchRequest(req);
+    return true;
+}
+
+void QOrganizerEDSEngine::runRequestSync(QOrganizerAbstractRequest *req)
+{
+    if (QThread::currentThread() != thread()) {
+        // clients and watchers belong to the engine thread
+        QMetaObject::invokeMethod(this, "runRequestSync",
+                                  Qt::BlockingQueuedConnection,
+                                  Q_ARG(QtOrganizer::QOrganizerAbstractRequest*, req));
+        return;
+    }
+
+    if (req->type() == QOrganizerAbstractRequest::CollectionSaveRequest) {
+        // finishes on a source registry signal which needs the main loop
+        startRequest(req);
+        waitForRequestFinished(req, 0);
+        return;
+    }
+
+    prepareRequest(req);
+
+    // the private context below does not dispatch the asynchronous
+    // connections, make sure the clients are ready before starting
+    Q_FOREACH(const QByteArray &sourceId, requestSourceIds(req)) {
+        EClient *client = d->m_sourceRegistry->client(sourceId);
+        if (client) {
+            g_object_unref(client);
+        }
+    }
+
+    // all EDS calls made by the request will report back on this context,
+    // nothing else (Qt events included) runs until the request is done
+    GMainContext *context = g_main_context_new();
+    g_main_context_push_thread_default(context);
+    m_syncRequests << req;
+    dispatchRequest(req);
+    while (req->state() == QOrganizerAbstractRequest::ActiveState) {
+        g_main_context_iteration(context, TRUE);
+    }
+    m_syncRequests.remove(req);
+    g_main_context_pop_thread_default(context);
+    g_main_context_unref(context);
+}
+
+void QOrganizerEDSEngine::prepareRequest(QOrganizerAbstractRequest *req)
+{
+    // collections are only watched once they are used, the view must be
+    // running before any change is written
+    bool writeRequest = (req->type() == QOrganizerAbstractRequest::ItemSaveRequest) ||
+                        (req->type() == QOrganizerAbstractRequest::ItemRemoveRequest) ||
+                        (req->type() == QOrganizerAbstractRequest::ItemRemoveByIdRequest);
+    if (writeRequest) {
+        // do not hand out results the write is about to change
+        invalidateCaches(req);
+    }
+    QByteArrayList sourceIds = requestSourceIds(req);
+    if (!writeRequest) {
+        // connect with all backends at once, fetches start with the first ready
+        d->m_sourceRegistry->prewarm(sourceIds);
+    }
+    Q_FOREACH(const QByteArray &sourceId, sourceIds) {
+        ViewWatcher *watcher = d->watch(d->m_sourceRegistry->collectionId(sourceId));
+        if (writeRequest) {
+            watcher->wait();
+        }
+    }
+}
+
+void QOrganizerEDSEngine::invalidateCaches(QOrganizerAbstractRequest *req)
+{
+    d->invalidateFetchResults();
+    Q_FOREACH(const QByteArray &sourceId, requestSourceIds(req)) {
+        d->m_instanceCache->clear(sourceId);
+    }
+}
+
+void QOrganizerEDSEngine::dispatchRequest(QOrganizerAbstractRequest *req)
+{
     switch (req->type())
     {
         case QOrganizerAbstractRequest::ItemFetchRequest:
@@ -1149,8 +1353,6 @@ bool QOrganizerEDSEngine::startRequest(QOrganizerAbstractRequest* req)
             qWarning() << "No implemented request" << req->type();
             break;
     }
-
-    return true;
 }
 
 bool QOrganizerEDSEngine::cancelRequest(QOrganizerAbstractRequest* req)
@@ -1270,10 +1472,69 @@ int QOrganizerEDSEngine::runningRequestCount() const
     return m_runningRequests.count();
 }
 
+bool QOrganizerEDSEngine::isWatching(const QOrganizerCollectionId &collectionId) const
+{
+    return d->isWatching(QByteArrayList() << collectionId.localId());
+}
+
+QByteArrayList QOrganizerEDSEngine::requestSourceIds(QOrganizerAbstractRequest *req) const
+{
+    QByteArrayList sourceIds;
+    QByteArray sourceId;
+
+    switch (req->type())
+    {
+        case QOrganizerAbstractRequest::ItemFetchRequest:
+            sourceIds = FetchRequestData::filterSourceIds(d->m_sourceRegistry->sourceIds(),
+                                                          qobject_cast<QOrganizerItemFetchRequest*>(req)->filter());
+            break;
+        case QOrganizerAbstractRequest::ItemFetchByIdRequest:
+            Q_FOREACH(const QOrganizerItemId &id, qobject_cast<QOrganizerItemFetchByIdRequest*>(req)->ids()) {
+                idToEds(id, &sourceId);
+                sourceIds << sourceId;
+            }
+            break;
+        case QOrganizerAbstractRequest::ItemOccurrenceFetchRequest:
+            sourceIds << qobject_cast<QOrganizerItemOccurrenceFetchRequest*>(req)->parentItem().collectionId().localId();
+            break;
+        case QOrganizerAbstractRequest::ItemSaveRequest:
+            Q_FOREACH(const QOrganizerItem &item, qobject_cast<QOrganizerItemSaveRequest*>(req)->items()) {
+                if (item.collectionId().isNull()) {
+                    sourceIds << d->m_sourceRegistry->defaultCollection().id().localId();
+                } else {
+                    sourceIds << item.collectionId().localId();
+                }
+            }
+            break;
+        case QOrganizerAbstractRequest::ItemRemoveRequest:
+            Q_FOREACH(const QOrganizerItem &item, qobject_cast<QOrganizerItemRemoveRequest*>(req)->items()) {
+                sourceIds << item.collectionId().localId();
+            }
+            break;
+        case QOrganizerAbstractRequest::ItemRemoveByIdRequest:
+            Q_FOREACH(const QOrganizerItemId &id, qobject_cast<QOrganizerItemRemoveByIdRequest*>(req)->itemIds()) {
+                idToEds(id, &sourceId);
+                sourceIds << sourceId;
+            }
+            break;
+        default:
+            break;
+    }
+
+    // only collections known by the registry can be watched
+    QByteArrayList result;
+    Q_FOREACH(const QByteArray &id, sourceIds) {
+        if (!result.contains(id) && !d->m_sourceRegistry->collectionId(id).isNull()) {
+            result << id;
+        }
+    }
+    return result;
+}
+
 void QOrganizerEDSEngine::onSourceAdded(const QByteArray &sourceId)
 {
+    d->invalidateFetchResults();
     QOrganizerCollectionId id(managerUri(), sourceId);
-    d->watch(id);
 
     Q_EMIT collectionsAdded(QList<QOrganizerCollectionId>() << id);
 
@@ -1284,6 +1545,7 @@ void QOrganizerEDSEngine::onSourceAdded(const QByteArray &sourceId)
 
 void QOrganizerEDSEngine::onSourceRemoved(const QByteArray &sourceId)
 {
+    d->invalidateFetchResults();
     d->unWatch(sourceId);
     QOrganizerCollectionId id(managerUri(), sourceId);
 
@@ -1296,6 +1558,7 @@ void QOrganizerEDSEngine::onSourceRemoved(const QByteArray &sourceId)
 
 void QOrganizerEDSEngine::onSourceUpdated(const QByteArray &sourceId)
 {
+    d->invalidateFetchResults();
     QOrganizerCollectionId id(managerUri(), sourceId);
     Q_EMIT collectionsChanged(QList<QOrganizerCollectionId>() << id);
 
@@ -1304,6 +1567,17 @@ void QOrganizerEDSEngine::onSourceUpdated(const QByteArray &sourceId)
     Q_EMIT collectionsModified(ops);
 }
 
+// the value and TZID of a date property, as e_cal_component_get_dtstart() reports them
+static const char *icalDateTime(icalproperty *prop, struct icaltimetype *value)
+{
+    *value = icalvalue_get_datetime(icalproperty_get_value(prop));
+    icalparameter *param = icalproperty_get_first_parameter(prop, ICAL_TZID_PARAMETER);
+    if (param) {
+        return icalparameter_get_tzid(param);
+    }
+    return icaltime_is_utc(*value) ? "UTC" : 0;
+}
+
 QDateTime QOrganizerEDSEngine::fromIcalTime(struct icaltimetype value, const char *tzId)
 {
     uint tmTime;
@@ -1311,37 +1585,28 @@ QDateTime QOrganizerEDSEngine::fromIcalTime(struct icaltimetype value, const cha
 
     // check if ialtimetype contais a time and timezone
     if (!allDayEvent && tzId) {
-        QByteArray tzLocationName;
-        icaltimezone *timezone = icaltimezone_get_builtin_timezone_from_tzid(tzId);
-
-        if (icaltime_is_utc(value)) {
-            tzLocationName = "UTC";
-        } else {
-            // fallback: sometimes the tzId contains the location name
-            if (!timezone) {
-                static const char prefix[] = "/freeassociation.sourceforge.net/Tzfile/";
-                if (strncmp(tzId, prefix, sizeof(prefix) - 1) == 0) {
-                    tzId += sizeof(prefix) - 1;
-                }
-                timezone = icaltimezone_get_builtin_timezone(tzId);
-            }
-            tzLocationName = QByteArray(icaltimezone_get_location(timezone));
+        if (icaltime_is_utc(value) || (strcmp(tzId, "UTC") == 0)) {
+            // UTC does not need any zone lookup or offset calculation
+            tmTime = icaltime_as_timet(value);
+            return QDateTime::fromTime_t(tmTime, TimeZoneCache::utc());
         }
 
+        QTimeZone qTz;
+        icaltimezone *timezone = TimeZoneCache::fromTzId(tzId, &qTz);
         tmTime = icaltime_as_timet_with_zone(value, timezone);
-        QTimeZone qTz(tzLocationName);
         return QDateTime::fromTime_t(tmTime, qTz);
     } else {
-        tmTime = icaltime_as_timet(value);
-        QDateTime t = QDateTime::fromTime_t(tmTime, Qt::UTC);
+        // the fields are used as they are, no epoch round trip needed
+        value = icaltime_is_null_time(value) ? icaltime_from_timet(0, allDayEvent)
+                                             : icaltime_normalize(value);
+        QDate date(value.year, value.month, value.day);
         // all day events will set as local time
         // floating time events will be set as UTC
         QDateTime tt;
         if (allDayEvent)
-          tt = QDateTime(t.date(), QTime(0,0,0),
-                         QTimeZone(QTimeZone::systemTimeZoneId()));
+          tt = QDateTime(date, QTime(0,0,0), TimeZoneCache::system());
         else
-          tt = QDateTime(t.date(), t.time(), Qt::UTC);
+          tt = QDateTime(date, QTime(value.hour, value.minute, value.second), Qt::UTC);
         return tt;
     }
 }
@@ -1358,7 +1623,7 @@ icaltimetype QOrganizerEDSEngine::fromQDateTime(const QDateTime &dateTime,
         case Qt::UTC:
         case Qt::OffsetFromUTC:
             // convert date to UTC timezone
-            tz = QTimeZone("UTC");
+            tz = TimeZoneCache::utc();
             finalDate = finalDate.toTimeZone(tz);
             break;
         case Qt::TimeZone:
@@ -1369,7 +1634,7 @@ icaltimetype QOrganizerEDSEngine::fromQDateTime(const QDateTime &dateTime,
             }
             break;
         case Qt::LocalTime:
-            tz = QTimeZone(QTimeZone::systemTimeZoneId());
+            tz = TimeZoneCache::system();
             finalDate = finalDate.toTimeZone(tz);
             break;
         default:
@@ -1378,8 +1643,7 @@ icaltimetype QOrganizerEDSEngine::fromQDateTime(const QDateTime &dateTime,
     }
 
     if (tz.isValid()) {
-        icaltimezone *timezone = 0;
-        timezone = icaltimezone_get_builtin_timezone(tz.id().constData());
+        icaltimezone *timezone = TimeZoneCache::builtin(tz.id());
         *tzId = QByteArray(icaltimezone_get_tzid(timezone));
         return icaltime_from_timet_with_zone(finalDate.toTime_t(), allDay, timezone);
     } else {
@@ -1393,58 +1657,64 @@ icaltimetype QOrganizerEDSEngine::fromQDateTime(const QDateTime &dateTime,
     }
 }
 
+void QOrganizerEDSEngine::parseStartTime(icalproperty *prop, QOrganizerItem *item)
+{
+    struct icaltimetype value;
+    const char *tzId = icalDateTime(prop, &value);
+    QOrganizerEventTime etr = item->detail(QOrganizerItemDetail::TypeEventTime);
+    QDateTime qdtime = fromIcalTime(value, tzId);
+    if (qdtime.isValid())
+        etr.setStartDateTime(qdtime);
+    if (icaltime_is_date(value) != etr.isAllDay()) {
+        etr.setAllDay(icaltime_is_date(value));
+    }
+    item->saveDetail(&etr);
+}
+
 void QOrganizerEDSEngine::parseStartTime(ECalComponent *comp, QOrganizerItem *item)
 {
-    ECalComponentDateTime *dt = g_new0(ECalComponentDateTime, 1);
-    e_cal_component_get_dtstart(comp, dt);
-    if (dt->value) {
-        QOrganizerEventTime etr = item->detail(QOrganizerItemDetail::TypeEventTime);
-        QDateTime qdtime = fromIcalTime(*dt->value, dt->tzid);
-        if (qdtime.isValid())
-            etr.setStartDateTime(qdtime);
-        if (icaltime_is_date(*dt->value) != etr.isAllDay()) {
-            etr.setAllDay(icaltime_is_date(*dt->value));
-        }
-        item->saveDetail(&etr);
+    icalproperty *prop = icalcomponent_get_first_property(e_cal_component_get_icalcomponent(comp),
+                                                          ICAL_DTSTART_PROPERTY);
+    if (prop) {
+        parseStartTime(prop, item);
     }
-    e_cal_component_free_datetime(dt);
-    g_free(dt);
 }
 
-void QOrganizerEDSEngine::parseTodoStartTime(ECalComponent *comp, QOrganizerItem *item)
+void QOrganizerEDSEngine::parseTodoStartTime(icalproperty *prop, QOrganizerItem *item)
 {
-    ECalComponentDateTime *dt = g_new0(ECalComponentDateTime, 1);
-    e_cal_component_get_dtstart(comp, dt);
-    if (dt->value) {
-        QOrganizerTodoTime etr = item->detail(QOrganizerItemDetail::TypeTodoTime);
-        QDateTime qdtime = fromIcalTime(*dt->value, dt->tzid);
-        if (qdtime.isValid())
-            etr.setStartDateTime(qdtime);
-        if (icaltime_is_date(*dt->value) != etr.isAllDay()) {
-            etr.setAllDay(icaltime_is_date(*dt->value));
-        }
-        item->saveDetail(&etr);
+    struct icaltimetype value;
+    const char *tzId = icalDateTime(prop, &value);
+    QOrganizerTodoTime etr = item->detail(QOrganizerItemDetail::TypeTodoTime);
+    QDateTime qdtime = fromIcalTime(value, tzId);
+    if (qdtime.isValid())
+        etr.setStartDateTime(qdtime);
+    if (icaltime_is_date(value) != etr.isAllDay()) {
+        etr.setAllDay(icaltime_is_date(value));
+    }
+    item->saveDetail(&etr);
+}
+
+void QOrganizerEDSEngine::parseEndTime(icalproperty *prop, QOrganizerItem *item)
+{
+    struct icaltimetype value;
+    const char *tzId = icalDateTime(prop, &value);
+    QOrganizerEventTime etr = item->detail(QOrganizerItemDetail::TypeEventTime);
+    QDateTime qdtime = fromIcalTime(value, tzId);
+    if (qdtime.isValid())
+        etr.setEndDateTime(qdtime);
+    if (icaltime_is_date(value) != etr.isAllDay()) {
+        etr.setAllDay(icaltime_is_date(value));
     }
-    e_cal_component_free_datetime(dt);
-    g_free(dt);
+    item->saveDetail(&etr);
 }
 
 void QOrganizerEDSEngine::parseEndTime(ECalComponent *comp, QOrganizerItem *item)
 {
-    ECalComponentDateTime *dt = g_new0(ECalComponentDateTime, 1);
-    e_cal_component_get_dtend(comp, dt);
-    if (dt->value) {
-        QOrganizerEventTime etr = item->detail(QOrganizerItemDetail::TypeEventTime);
-        QDateTime qdtime = fromIcalTime(*dt->value, dt->tzid);
-        if (qdtime.isValid())
-            etr.setEndDateTime(qdtime);
-        if (icaltime_is_date(*dt->value) != etr.isAllDay()) {
-            etr.setAllDay(icaltime_is_date(*dt->value));
-        }
-        item->saveDetail(&etr);
+    icalproperty *prop = icalcomponent_get_first_property(e_cal_component_get_icalcomponent(comp),
+                                                          ICAL_DTEND_PROPERTY);
+    if (prop) {
+        parseEndTime(prop, item);
     }
-    e_cal_component_free_datetime(dt);
-    g_free(dt);
 }
 
 void QOrganizerEDSEngine::parseWeekRecurrence(struct icalrecurrencetype *rule, QtOrganizer::QOrganizerRecurrenceRule *qRule)
@@ -1510,132 +1780,125 @@ void QOrganizerEDSEngine::parseYearRecurrence(struct icalrecurrencetype *rule, Q
     qRule->setMonthsOfYear(monthOfYear);
 }
 
-void QOrganizerEDSEngine::parseRecurrence(ECalComponent *comp, QOrganizerItem *item)
+void QOrganizerEDSEngine::parseRecurrenceDate(icalproperty *prop, QOrganizerItem *item)
 {
-    // recurence
-    if (e_cal_component_has_rdates(comp)) {
-        QSet<QDate> dates;
-        GSList *periodList = 0;
-        e_cal_component_get_rdate_list(comp, &periodList);
-        for(GSList *i = periodList; i != 0; i = i->next) {
-            ECalComponentPeriod *period = (ECalComponentPeriod*) i->data;
-            //TODO: get timezone info
-            QDateTime dt = fromIcalTime(period->start, 0);
-            if (dt.isValid())
-                dates.insert(dt.date());
-            //TODO: period.end, period.duration
-        }
-        e_cal_component_free_period_list(periodList);
+    struct icaldatetimeperiodtype period = icalproperty_get_rdate(prop);
+    QOrganizerItemRecurrence rec = item->detail(QOrganizerItemDetail::TypeRecurrence);
+    QSet<QDate> dates = rec.recurrenceDates();
+    //TODO: get timezone info
+    QDateTime dt = fromIcalTime(icaltime_is_null_time(period.time) ? period.period.start : period.time, 0);
+    if (dt.isValid())
+        dates.insert(dt.date());
+    //TODO: period.end, period.duration
+    rec.setRecurrenceDates(dates);
+    item->saveDetail(&rec);
+}
 
-        QOrganizerItemRecurrence rec = item->detail(QOrganizerItemDetail::TypeRecurrence);
-        rec.setRecurrenceDates(dates);
-        item->saveDetail(&rec);
-    }
+void QOrganizerEDSEngine::parseExceptionDate(icalproperty *prop, QOrganizerItem *item)
+{
+    struct icaltimetype value;
+    const char *tzId = icalDateTime(prop, &value);
+    QOrganizerItemRecurrence irec = item->detail(QOrganizerItemDetail::TypeRecurrence);
+    QSet<QDate> dates = irec.exceptionDates();
+    QDateTime dt = fromIcalTime(value, tzId);
+    if (dt.isValid())
+        dates.insert(dt.date());
+    irec.setExceptionDates(dates);
+    item->saveDetail(&irec);
+}
 
-    if (e_cal_component_has_exdates(comp)) {
-        QSet<QDate> dates;
-        GSList *exdateList = 0;
+void QOrganizerEDSEngine::parseRecurrenceRule(icalproperty *prop, QOrganizerItem *item)
+{
+    struct icalrecurrencetype rule = icalproperty_get_rrule(prop);
+    QOrganizerRecurrenceRule qRule;
+    switch (rule.freq) {
+        case ICAL_SECONDLY_RECURRENCE:
+        case ICAL_MINUTELY_RECURRENCE:
+        case ICAL_HOURLY_RECURRENCE:
+            qWarning() << "Recurrence frequency not supported";
+            break;
+        case ICAL_DAILY_RECURRENCE:
+            qRule.setFrequency(QOrganizerRecurrenceRule::Daily);
+            break;
+        case ICAL_WEEKLY_RECURRENCE:
+            parseWeekRecurrence(&rule, &qRule);
+            break;
+        case ICAL_MONTHLY_RECURRENCE:
+            parseMonthRecurrence(&rule, &qRule);
+            break;
+        case ICAL_YEARLY_RECURRENCE:
+            parseYearRecurrence(&rule, &qRule);
+            break;
+        case ICAL_NO_RECURRENCE:
+            break;
+    }
 
-        e_cal_component_get_exdate_list(comp, &exdateList);
-        for(GSList *i = exdateList; i != 0; i = i->next) {
-            ECalComponentDateTime* dateTime = (ECalComponentDateTime*) i->data;
-            QDateTime dt = fromIcalTime(*dateTime->value, dateTime->tzid);
-            if (dt.isValid())
-                dates.insert(dt.date());
+    if (icaltime_is_date(rule.until)) {
+        QDate dt = QDate::fromString(icaltime_as_ical_string(rule.until), "yyyyMMdd");
+        if (dt.isValid()) {
+            qRule.setLimit(dt);
         }
-        e_cal_component_free_exdate_list(exdateList);
-
-        QOrganizerItemRecurrence irec = item->detail(QOrganizerItemDetail::TypeRecurrence);
-        irec.setExceptionDates(dates);
-        item->saveDetail(&irec);
-    }
-
-    // rules
-    GSList *ruleList = 0;
-    e_cal_component_get_rrule_list(comp, &ruleList);
-    if (ruleList) {
-        QSet<QOrganizerRecurrenceRule> qRules;
-
-        for(GSList *i = ruleList; i != 0; i = i->next) {
-            struct icalrecurrencetype *rule = (struct icalrecurrencetype*) i->data;
-            QOrganizerRecurrenceRule qRule;
-            switch (rule->freq) {
-                case ICAL_SECONDLY_RECURRENCE:
-                case ICAL_MINUTELY_RECURRENCE:
-                case ICAL_HOURLY_RECURRENCE:
-                    qWarning() << "Recurrence frequency not supported";
-                    break;
-                case ICAL_DAILY_RECURRENCE:
-                    qRule.setFrequency(QOrganizerRecurrenceRule::Daily);
-                    break;
-                case ICAL_WEEKLY_RECURRENCE:
-                    parseWeekRecurrence(rule, &qRule);
-                    break;
-                case ICAL_MONTHLY_RECURRENCE:
-                    parseMonthRecurrence(rule, &qRule);
-                    break;
-                case ICAL_YEARLY_RECURRENCE:
-                    parseYearRecurrence(rule, &qRule);
-                    break;
-                case ICAL_NO_RECURRENCE:
-                    break;
-            }
-
-            if (icaltime_is_date(rule->until)) {
-                QDate dt = QDate::fromString(icaltime_as_ical_string(rule->until), "yyyyMMdd");
-                if (dt.isValid()) {
-                    qRule.setLimit(dt);
-                }
-            } else if (rule->count > 0) {
-                qRule.setLimit(rule->count);
-            }
-
-            qRule.setInterval(rule->interval);
-
-            QSet<int> positions;
-            for (int d=0; d < ICAL_BY_SETPOS_SIZE; d++) {
-                short day = rule->by_set_pos[d];
-                if (day != ICAL_RECURRENCE_ARRAY_MAX) {
-                    positions.insert(day);
-                }
-            }
-            qRule.setPositions(positions);
+    } else if (rule.count > 0) {
+        qRule.setLimit(rule.count);
+    }
 
-            qRules << qRule;
-        }
+    qRule.setInterval(rule.interval);
 
-        if (!qRules.isEmpty()) {
-            QOrganizerItemRecurrence irec = item->detail(QOrganizerItemDetail::TypeRecurrence);
-            irec.setRecurrenceRules(qRules);
-            item->saveDetail(&irec);
+    QSet<int> positions;
+    for (int d=0; d < ICAL_BY_SETPOS_SIZE; d++) {
+        short day = rule.by_set_pos[d];
+        if (day != ICAL_RECURRENCE_ARRAY_MAX) {
+            positions.insert(day);
         }
-
-        e_cal_component_free_recur_list(ruleList);
     }
+    qRule.setPositions(positions);
+
+    QOrganizerItemRecurrence irec = item->detail(QOrganizerItemDetail::TypeRecurrence);
+    QSet<QOrganizerRecurrenceRule> qRules = irec.recurrenceRules();
+    qRules << qRule;
+    irec.setRecurrenceRules(qRules);
+    item->saveDetail(&irec);
     // TODO: exeptions rules
 }
 
-void QOrganizerEDSEngine::parsePriority(ECalComponent *comp, QOrganizerItem *item)
+void QOrganizerEDSEngine::parseRecurrence(ECalComponent *comp, QOrganizerItem *item)
 {
-    gint *priority = 0;
-    e_cal_component_get_priority(comp, &priority);
-    if (priority) {
-        QOrganizerItemPriority iPriority = item->detail(QOrganizerItemDetail::TypePriority);
-        if ((*priority >= QOrganizerItemPriority::UnknownPriority) &&
-            (*priority <= QOrganizerItemPriority::LowPriority)) {
-            iPriority.setPriority((QOrganizerItemPriority::Priority) *priority);
-        } else {
-            iPriority.setPriority(QOrganizerItemPriority::UnknownPriority);
+    icalcomponent *ical = e_cal_component_get_icalcomponent(comp);
+    for (icalproperty *prop = icalcomponent_get_first_property(ical, ICAL_ANY_PROPERTY);
+         prop != 0;
+         prop = icalcomponent_get_next_property(ical, ICAL_ANY_PROPERTY)) {
+        switch (icalproperty_isa(prop)) {
+        case ICAL_RDATE_PROPERTY:
+            parseRecurrenceDate(prop, item);
+            break;
+        case ICAL_EXDATE_PROPERTY:
+            parseExceptionDate(prop, item);
+            break;
+        case ICAL_RRULE_PROPERTY:
+            parseRecurrenceRule(prop, item);
+            break;
+        default:
+            break;
         }
-        e_cal_component_free_priority(priority);
-        item->saveDetail(&iPriority);
     }
 }
 
-void QOrganizerEDSEngine::parseLocation(ECalComponent *comp, QOrganizerItem *item)
+void QOrganizerEDSEngine::parsePriority(icalproperty *prop, QOrganizerItem *item)
+{
+    int priority = icalproperty_get_priority(prop);
+    QOrganizerItemPriority iPriority = item->detail(QOrganizerItemDetail::TypePriority);
+    if ((priority >= QOrganizerItemPriority::UnknownPriority) &&
+        (priority <= QOrganizerItemPriority::LowPriority)) {
+        iPriority.setPriority((QOrganizerItemPriority::Priority) priority);
+    } else {
+        iPriority.setPriority(QOrganizerItemPriority::UnknownPriority);
+    }
+    item->saveDetail(&iPriority);
+}
+
+void QOrganizerEDSEngine::parseLocation(icalproperty *prop, QOrganizerItem *item)
 {
-    const gchar *location;
-    e_cal_component_get_location(comp, &location);
+    const gchar *location = icalproperty_get_location(prop);
     if (location) {
         QOrganizerItemLocation ld = item->detail(QOrganizerItemDetail::TypeLocation);
         ld.setLabel(QString::fromUtf8(location));
@@ -1643,26 +1906,23 @@ void QOrganizerEDSEngine::parseLocation(ECalComponent *comp, QOrganizerItem *ite
     }
 }
 
-void QOrganizerEDSEngine::parseDueDate(ECalComponent *comp, QOrganizerItem *item)
+void QOrganizerEDSEngine::parseDueDate(icalproperty *prop, QOrganizerItem *item)
 {
-    ECalComponentDateTime due;
-    e_cal_component_get_due(comp, &due);
-    if (due.value) {
-        QOrganizerTodoTime ttr = item->detail(QOrganizerItemDetail::TypeTodoTime);
-        QDateTime qdtime = fromIcalTime(*due.value, due.tzid);
-        if (qdtime.isValid())
-            ttr.setDueDateTime(qdtime);
-        if (icaltime_is_date(*due.value) != ttr.isAllDay()) {
-            ttr.setAllDay(icaltime_is_date(*due.value));
-        }
-        item->saveDetail(&ttr);
+    struct icaltimetype value;
+    const char *tzId = icalDateTime(prop, &value);
+    QOrganizerTodoTime ttr = item->detail(QOrganizerItemDetail::TypeTodoTime);
+    QDateTime qdtime = fromIcalTime(value, tzId);
+    if (qdtime.isValid())
+        ttr.setDueDateTime(qdtime);
+    if (icaltime_is_date(value) != ttr.isAllDay()) {
+        ttr.setAllDay(icaltime_is_date(value));
     }
-    e_cal_component_free_datetime(&due);
+    item->saveDetail(&ttr);
 }
 
-void QOrganizerEDSEngine::parseProgress(ECalComponent *comp, QOrganizerItem *item)
+void QOrganizerEDSEngine::parseProgress(icalproperty *prop, QOrganizerItem *item)
 {
-    gint percentage = e_cal_component_get_percent_as_int(comp);
+    int percentage = icalproperty_get_percentcomplete(prop);
     if (percentage > 0 && percentage <= 100) {
         QOrganizerTodoProgress tp = item->detail(QOrganizerItemDetail::TypeTodoProgress);
         tp.setPercentageComplete(percentage);
@@ -1670,11 +1930,8 @@ void QOrganizerEDSEngine::parseProgress(ECalComponent *comp, QOrganizerItem *ite
     }
 }
 
-void QOrganizerEDSEngine::parseStatus(ECalComponent *comp, QOrganizerItem *item)
+void QOrganizerEDSEngine::parseStatus(icalproperty_status status, QOrganizerItem *item)
 {
-    icalproperty_status status;
-    e_cal_component_get_status(comp, &status);
-
     QOrganizerTodoProgress tp;
     switch(status) {
         case ICAL_STATUS_NONE:
@@ -1694,365 +1951,291 @@ void QOrganizerEDSEngine::parseStatus(ECalComponent *comp, QOrganizerItem *item)
     item->saveDetail(&tp);
 }
 
-void QOrganizerEDSEngine::parseAttendeeList(ECalComponent *comp, QOrganizerItem *item)
-{
-    GSList *attendeeList = 0;
-    e_cal_component_get_attendee_list(comp, &attendeeList);
-    for (GSList *attendeeIter=attendeeList; attendeeIter != 0; attendeeIter = attendeeIter->next) {
-        ECalComponentAttendee *attendee = static_cast<ECalComponentAttendee *>(attendeeIter->data);
-        QOrganizerEventAttendee qAttendee;
-
-        qAttendee.setAttendeeId(QString::fromUtf8(attendee->member));
-        qAttendee.setName(QString::fromUtf8(attendee->cn));
-        qAttendee.setEmailAddress(QString::fromUtf8(attendee->value));
-
-        switch(attendee->role) {
-        case ICAL_ROLE_REQPARTICIPANT:
-            qAttendee.setParticipationRole(QOrganizerEventAttendee::RoleRequiredParticipant);
-            break;
-        case ICAL_ROLE_OPTPARTICIPANT:
-            qAttendee.setParticipationRole(QOrganizerEventAttendee::RoleOptionalParticipant);
-            break;
-        case ICAL_ROLE_CHAIR:
-            qAttendee.setParticipationRole(QOrganizerEventAttendee::RoleChairperson);
-            break;
-        case ICAL_ROLE_X:
-            qAttendee.setParticipationRole(QOrganizerEventAttendee::RoleHost);
-            break;
-        case ICAL_ROLE_NONE:
-        default:
-            qAttendee.setParticipationRole(QOrganizerEventAttendee::RoleNonParticipant);
-            break;
-        }
-
-        switch(attendee->status) {
-        case ICAL_PARTSTAT_ACCEPTED:
-            qAttendee.setParticipationStatus(QOrganizerEventAttendee::StatusAccepted);
-            break;
-        case ICAL_PARTSTAT_DECLINED:
-            qAttendee.setParticipationStatus(QOrganizerEventAttendee::StatusDeclined);
-            break;
-        case ICAL_PARTSTAT_TENTATIVE:
-            qAttendee.setParticipationStatus(QOrganizerEventAttendee::StatusTentative);
-            break;
-        case ICAL_PARTSTAT_DELEGATED:
-            qAttendee.setParticipationStatus(QOrganizerEventAttendee::StatusDelegated);
-            break;
-        case ICAL_PARTSTAT_COMPLETED:
-            qAttendee.setParticipationStatus(QOrganizerEventAttendee::StatusCompleted);
-            break;
-        case ICAL_PARTSTAT_INPROCESS:
-            qAttendee.setParticipationStatus(QOrganizerEventAttendee::StatusInProcess);
-            break;
-        case ICAL_PARTSTAT_NEEDSACTION:
-        case ICAL_PARTSTAT_NONE:
-        default:
-            qAttendee.setParticipationStatus(QOrganizerEventAttendee::StatusUnknown);
-            break;
-
-        }
-        item->saveDetail(&qAttendee);
-    }
-    e_cal_component_free_attendee_list(attendeeList);
-}
-
-void QOrganizerEDSEngine::parseExtendedDetails(ECalComponent *comp, QOrganizerItem *item)
-{
-    icalcomponent *icalcomp = e_cal_component_get_icalcomponent(comp);
-    for (icalproperty *prop = icalcomponent_get_first_property(icalcomp, ICAL_X_PROPERTY);
-         prop != NULL;
-         prop = icalcomponent_get_next_property (icalcomp, ICAL_X_PROPERTY)) {
-
-        QOrganizerItemExtendedDetail ex;
-        ex.setName(QString::fromUtf8(icalproperty_get_x_name(prop)));
-        ex.setData(QByteArray(icalproperty_get_x(prop)));
-        item->saveDetail(&ex);
-    }
-}
-
-QOrganizerItem *QOrganizerEDSEngine::parseEvent(ECalComponent *comp,
-                                                QList<QOrganizerItemDetail::DetailType> detailsHint)
-{
-    QOrganizerItem *event;
-    if (hasRecurrence(comp)) {
-        event = new QOrganizerEventOccurrence();
-    } else {
-        event = new QOrganizerEvent();
-    }
-    if (detailsHint.isEmpty() ||
-        detailsHint.contains(QOrganizerItemDetail::TypeEventTime)) {
-        parseStartTime(comp, event);
-        parseEndTime(comp, event);
-    }
-
-    if (detailsHint.isEmpty() ||
-        detailsHint.contains(QOrganizerItemDetail::TypeRecurrence)) {
-        parseRecurrence(comp, event);
-    }
-
-    if (detailsHint.isEmpty() ||
-        detailsHint.contains(QOrganizerItemDetail::TypePriority)) {
-        parsePriority(comp, event);
-    }
-
-    if (detailsHint.isEmpty() ||
-        detailsHint.contains(QOrganizerItemDetail::TypeLocation)) {
-        parseLocation(comp, event);
-    }
-    return event;
-}
-
-QOrganizerItem *QOrganizerEDSEngine::parseToDo(ECalComponent *comp,
-                                               QList<QOrganizerItemDetail::DetailType> detailsHint)
-{
-    QOrganizerItem *todo;
-    if (hasRecurrence(comp)) {
-        todo = new QOrganizerTodoOccurrence();
-    } else {
-        todo = new QOrganizerTodo();
-    }
-
-    if (detailsHint.isEmpty() ||
-        detailsHint.contains(QOrganizerItemDetail::TypeTodoTime)) {
-        parseTodoStartTime(comp, todo);
-        parseDueDate(comp, todo);
-    }
-
-    if (detailsHint.isEmpty() ||
-        detailsHint.contains(QOrganizerItemDetail::TypeRecurrence)) {
-        parseRecurrence(comp, todo);
-    }
-
-    if (detailsHint.isEmpty() ||
-        detailsHint.contains(QOrganizerItemDetail::TypePriority)) {
-        parsePriority(comp, todo);
-    }
-
-    if (detailsHint.isEmpty() ||
-        detailsHint.contains(QOrganizerItemDetail::TypeTodoProgress)) {
-        parseProgress(comp, todo);
-        parseStatus(comp, todo);
+void QOrganizerEDSEngine::parseAttendee(icalproperty *prop, QOrganizerItem *item)
+{
+    QOrganizerEventAttendee qAttendee;
+
+    icalparameter *param = icalproperty_get_first_parameter(prop, ICAL_MEMBER_PARAMETER);
+    qAttendee.setAttendeeId(QString::fromUtf8(param ? icalparameter_get_member(param) : 0));
+    param = icalproperty_get_first_parameter(prop, ICAL_CN_PARAMETER);
+    qAttendee.setName(QString::fromUtf8(param ? icalparameter_get_cn(param) : 0));
+    qAttendee.setEmailAddress(QString::fromUtf8(icalproperty_get_attendee(prop)));
+
+    param = icalproperty_get_first_parameter(prop, ICAL_ROLE_PARAMETER);
+    icalparameter_role role = param ? icalparameter_get_role(param) : ICAL_ROLE_NONE;
+    param = icalproperty_get_first_parameter(prop, ICAL_PARTSTAT_PARAMETER);
+    icalparameter_partstat status = param ? icalparameter_get_partstat(param) : ICAL_PARTSTAT_NONE;
+
+    switch(role) {
+    case ICAL_ROLE_REQPARTICIPANT:
+        qAttendee.setParticipationRole(QOrganizerEventAttendee::RoleRequiredParticipant);
+        break;
+    case ICAL_ROLE_OPTPARTICIPANT:
+        qAttendee.setParticipationRole(QOrganizerEventAttendee::RoleOptionalParticipant);
+        break;
+    case ICAL_ROLE_CHAIR:
+        qAttendee.setParticipationRole(QOrganizerEventAttendee::RoleChairperson);
+        break;
+    case ICAL_ROLE_X:
+        qAttendee.setParticipationRole(QOrganizerEventAttendee::RoleHost);
+        break;
+    case ICAL_ROLE_NONE:
+    default:
+        qAttendee.setParticipationRole(QOrganizerEventAttendee::RoleNonParticipant);
+        break;
     }
 
-    return todo;
-}
-
-QOrganizerItem *QOrganizerEDSEngine::parseJournal(ECalComponent *comp,
-                                                  QList<QOrganizerItemDetail::DetailType> detailsHint)
-{
-    QOrganizerJournal *journal = new QOrganizerJournal();
-
-    if (detailsHint.isEmpty() ||
-        detailsHint.contains(QOrganizerItemDetail::TypeJournalTime)) {
-        ECalComponentDateTime dt;
-        e_cal_component_get_dtstart(comp, &dt);
-        if (dt.value) {
-            QDateTime qdtime = fromIcalTime(*dt.value, dt.tzid);
-            if (qdtime.isValid()) {
-              QOrganizerJournalTime jtime;
-              jtime.setEntryDateTime(qdtime);
-              journal->saveDetail(&jtime);
-            }
-        }
-        e_cal_component_free_datetime(&dt);
+    switch(status) {
+    case ICAL_PARTSTAT_ACCEPTED:
+        qAttendee.setParticipationStatus(QOrganizerEventAttendee::StatusAccepted);
+        break;
+    case ICAL_PARTSTAT_DECLINED:
+        qAttendee.setParticipationStatus(QOrganizerEventAttendee::StatusDeclined);
+        break;
+    case ICAL_PARTSTAT_TENTATIVE:
+        qAttendee.setParticipationStatus(QOrganizerEventAttendee::StatusTentative);
+        break;
+    case ICAL_PARTSTAT_DELEGATED:
+        qAttendee.setParticipationStatus(QOrganizerEventAttendee::StatusDelegated);
+        break;
+    case ICAL_PARTSTAT_COMPLETED:
+        qAttendee.setParticipationStatus(QOrganizerEventAttendee::StatusCompleted);
+        break;
+    case ICAL_PARTSTAT_INPROCESS:
+        qAttendee.setParticipationStatus(QOrganizerEventAttendee::StatusInProcess);
+        break;
+    case ICAL_PARTSTAT_NEEDSACTION:
+    case ICAL_PARTSTAT_NONE:
+    default:
+        qAttendee.setParticipationStatus(QOrganizerEventAttendee::StatusUnknown);
+        break;
+
+    }
+    item->saveDetail(&qAttendee);
+}
+
+void QOrganizerEDSEngine::parseExtendedDetail(icalproperty *prop, QOrganizerItem *item)
+{
+    QOrganizerItemExtendedDetail ex;
+    ex.setName(QString::fromUtf8(icalproperty_get_x_name(prop)));
+    ex.setData(QByteArray(icalproperty_get_x(prop)));
+    item->saveDetail(&ex);
+}
+
+void QOrganizerEDSEngine::parseJournalTime(icalproperty *prop, QOrganizerItem *item)
+{
+    struct icaltimetype value;
+    const char *tzId = icalDateTime(prop, &value);
+    QDateTime qdtime = fromIcalTime(value, tzId);
+    if (qdtime.isValid()) {
+      QOrganizerJournalTime jtime;
+      jtime.setEntryDateTime(qdtime);
+      item->saveDetail(&jtime);
     }
-
-    return journal;
 }
 
 QByteArray QOrganizerEDSEngine::toComponentId(const QByteArray &itemId, QByteArray *rid)
 {
-    QList<QByteArray> ids = itemId.split('/').last().split('#');
-    if (ids.size() == 2) {
-        *rid = ids[1];
+    // itemId is the uid part of the local id, the recurrence id is appended
+    // after a '#'
+    int separator = itemId.lastIndexOf('#');
+    if (separator < 0) {
+        return itemId;
     }
-    return ids[0];
+    *rid = itemId.mid(separator + 1);
+    return itemId.left(separator);
 }
 
 ECalComponentId *QOrganizerEDSEngine::ecalComponentId(const QOrganizerItemId &itemId)
 {
-    QByteArray edsItemId = idToEds(itemId);
-    QStringList ids = QString::fromUtf8(edsItemId).split("#");
-
-    QString cId = ids[0];
-    QString rId = (ids.size() == 2) ? ids[1] : QString();
-
+    QByteArray rId;
+    QByteArray cId = toComponentId(idToEds(itemId), &rId);
 
     ECalComponentId *id = g_new0(ECalComponentId, 1);
-    id->uid = g_strdup(cId.toUtf8().data());
+    id->uid = g_strdup(cId.constData());
     if (rId.isEmpty()) {
         id->rid = NULL;
     } else {
-        id->rid = g_strdup(rId.toUtf8().data());
+        id->rid = g_strdup(rId.constData());
     }
 
     return id;
 }
 
-void QOrganizerEDSEngine::parseSummary(ECalComponent *comp, QtOrganizer::QOrganizerItem *item)
+void QOrganizerEDSEngine::parseSummary(icalproperty *prop, QtOrganizer::QOrganizerItem *item)
 {
-    ECalComponentText summary;
-    e_cal_component_get_summary(comp, &summary);
-    if (summary.value) {
-        item->setDisplayLabel(QString::fromUtf8(summary.value));
+    const char *summary = icalproperty_get_summary(prop);
+    if (summary) {
+        item->setDisplayLabel(QString::fromUtf8(summary));
     }
 }
 
-void QOrganizerEDSEngine::parseDescription(ECalComponent *comp, QtOrganizer::QOrganizerItem *item)
+void QOrganizerEDSEngine::parseDescription(icalproperty *prop, QtOrganizer::QOrganizerItem *item)
 {
-
-    GSList *descriptions = 0;
-    e_cal_component_get_description_list(comp, &descriptions);
-
-    QStringList itemDescription;
-
-    for(GSList *descList = descriptions; descList != 0; descList = descList->next) {
-        ECalComponentText *description = static_cast<ECalComponentText*>(descList->data);
-        if (description && description->value) {
-            itemDescription.append(QString::fromUtf8(description->value));
+    const char *description = icalproperty_get_description(prop);
+    if (description) {
+        // several descriptions are joined in a single one
+        if (item->detail(QOrganizerItemDetail::TypeDescription).isEmpty()) {
+            item->setDescription(QString::fromUtf8(description));
+        } else {
+            item->setDescription(item->description() + "\n" + QString::fromUtf8(description));
         }
     }
-
-    item->setDescription(itemDescription.join("\n"));
-    e_cal_component_free_text_list(descriptions);
 }
 
-void QOrganizerEDSEngine::parseComments(ECalComponent *comp, QtOrganizer::QOrganizerItem *item)
+void QOrganizerEDSEngine::parseComment(icalproperty *prop, QtOrganizer::QOrganizerItem *item)
 {
-    GSList *comments = 0;
-    e_cal_component_get_comment_list(comp, &comments);
-    for(int ci=0, ciMax=g_slist_length(comments); ci < ciMax; ci++) {
-        ECalComponentText *txt = static_cast<ECalComponentText*>(g_slist_nth_data(comments, ci));
-        item->addComment(QString::fromUtf8(txt->value));
-    }
-    e_cal_component_free_text_list(comments);
+    item->addComment(QString::fromUtf8(icalproperty_get_comment(prop)));
 }
 
-void QOrganizerEDSEngine::parseTags(ECalComponent *comp, QtOrganizer::QOrganizerItem *item)
+void QOrganizerEDSEngine::parseTags(icalproperty *prop, QtOrganizer::QOrganizerItem *item)
 {
-    GSList *categories = 0;
-    e_cal_component_get_categories_list(comp, &categories);
-    for(GSList *tag=categories; tag != 0; tag = tag->next) {
-        item->addTag(QString::fromUtf8(static_cast<gchar*>(tag->data)));
+    // a single property can carry a comma separated list, split it in place
+    const char *tag = icalproperty_get_categories(prop);
+    while (tag && *tag) {
+        const char *end = strchr(tag, ',');
+        int size = end ? (end - tag) : strlen(tag);
+        if (size > 0) {
+            item->addTag(QString::fromUtf8(tag, size));
+        }
+        tag = end ? end + 1 : tag + size;
     }
-    e_cal_component_free_categories_list(categories);
 }
 
-QUrl QOrganizerEDSEngine::dencodeAttachment(ECalComponentAlarm *alarm)
+QUrl QOrganizerEDSEngine::dencodeAttachment(icalproperty *prop)
 {
     QUrl attachment;
 
-    icalattach *attach = 0;
-    e_cal_component_alarm_get_attach(alarm, &attach);
-    if (attach) {
-        if (icalattach_get_is_url(attach)) {
-            const gchar *url = icalattach_get_url(attach);
-            attachment = QUrl(QString::fromUtf8(url));
-        }
-        icalattach_unref(attach);
+    icalattach *attach = icalproperty_get_attach(prop);
+    if (attach && icalattach_get_is_url(attach)) {
+        const gchar *url = icalattach_get_url(attach);
+        attachment = QUrl(QString::fromUtf8(url));
     }
 
     return attachment;
 }
 
-void QOrganizerEDSEngine::parseVisualReminderAttachment(ECalComponentAlarm *alarm, QOrganizerItemReminder *aDetail)
+void QOrganizerEDSEngine::parseReminder(icalcomponent *alarm,
+                                        QtOrganizer::QOrganizerItem *item,
+                                        QList<QtOrganizer::QOrganizerItemDetail::DetailType> detailsHint)
 {
-    QUrl attach = dencodeAttachment(alarm);
-    if (attach.isValid()) {
-        aDetail->setValue(QOrganizerItemVisualReminder::FieldDataUrl, attach);
-    }
-
-    ECalComponentText txt;
-    e_cal_component_alarm_get_description(alarm, &txt);
-    aDetail->setValue(QOrganizerItemVisualReminder::FieldMessage, QString::fromUtf8(txt.value));
-}
+    icalproperty_action aAction = ICAL_ACTION_NONE;
+    icalproperty *trigger = 0;
+    icalproperty *repeat = 0;
+    icalproperty *duration = 0;
+    icalproperty *attach = 0;
+    icalproperty *description = 0;
 
-void QOrganizerEDSEngine::parseAudibleReminderAttachment(ECalComponentAlarm *alarm, QOrganizerItemReminder *aDetail)
-{
-    QUrl attach = dencodeAttachment(alarm);
-    if (attach.isValid()) {
-        aDetail->setValue(QOrganizerItemAudibleReminder::FieldDataUrl, attach);
+    for (icalproperty *prop = icalcomponent_get_first_property(alarm, ICAL_ANY_PROPERTY);
+         prop != 0;
+         prop = icalcomponent_get_next_property(alarm, ICAL_ANY_PROPERTY)) {
+        switch (icalproperty_isa(prop)) {
+        case ICAL_ACTION_PROPERTY:
+            aAction = icalproperty_get_action(prop);
+            break;
+        case ICAL_TRIGGER_PROPERTY:
+            trigger = trigger ? trigger : prop;
+            break;
+        case ICAL_REPEAT_PROPERTY:
+            repeat = repeat ? repeat : prop;
+            break;
+        case ICAL_DURATION_PROPERTY:
+            duration = duration ? duration : prop;
+            break;
+        case ICAL_ATTACH_PROPERTY:
+            attach = attach ? attach : prop;
+            break;
+        case ICAL_DESCRIPTION_PROPERTY:
+            description = description ? description : prop;
+            break;
+        default:
+            break;
+        }
     }
-}
-
-void QOrganizerEDSEngine::parseReminders(ECalComponent *comp,
-                                         QtOrganizer::QOrganizerItem *item,
-                                         QList<QtOrganizer::QOrganizerItemDetail::DetailType> detailsHint)
-{
-    GList *alarms = e_cal_component_get_alarm_uids(comp);
-    for(GList *a = alarms; a != 0; a = a->next) {
-        QOrganizerItemReminder *aDetail = 0;
 
-        QSharedPointer<ECalComponentAlarm> alarm(e_cal_component_get_alarm(comp, static_cast<const gchar*>(a->data)),
-                                                 e_cal_component_alarm_free);
-        if (!alarm) {
-            continue;
+    bool visual = (aAction == ICAL_ACTION_DISPLAY);
+    if (!detailsHint.isEmpty() &&
+        !detailsHint.contains(QOrganizerItemDetail::TypeReminder)) {
+        if (visual && !detailsHint.contains(QOrganizerItemDetail::TypeVisualReminder)) {
+            return;
         }
-        ECalComponentAlarmAction aAction;
-
-        e_cal_component_alarm_get_action(alarm.data(), &aAction);
-        switch(aAction)
-        {
-            case E_CAL_COMPONENT_ALARM_DISPLAY:
-                if (!detailsHint.isEmpty() &&
-                    !detailsHint.contains(QOrganizerItemDetail::TypeReminder) &&
-                    !detailsHint.contains(QOrganizerItemDetail::TypeVisualReminder)) {
-                    continue;
-                }
-                aDetail = new QOrganizerItemVisualReminder();
-                parseVisualReminderAttachment(alarm.data(), aDetail);
-                break;
-            case E_CAL_COMPONENT_ALARM_AUDIO:
-                if (!detailsHint.isEmpty() &&
-                    !detailsHint.contains(QOrganizerItemDetail::TypeReminder) &&
-                    !detailsHint.contains(QOrganizerItemDetail::TypeAudibleReminder)) {
-                    continue;
-                }
-
-            // use audio as fallback
-            default:
-                aDetail = new QOrganizerItemAudibleReminder();
-                parseAudibleReminderAttachment(alarm.data(), aDetail);
-                break;
+        // use audio as fallback
+        if ((aAction == ICAL_ACTION_AUDIO) &&
+            !detailsHint.contains(QOrganizerItemDetail::TypeAudibleReminder)) {
+            return;
         }
+    }
 
-        ECalComponentAlarmTrigger trigger;
-        e_cal_component_alarm_get_trigger(alarm.data(), &trigger);
-        int relSecs = 0;
-        bool fail = false;
-        if (trigger.type == E_CAL_COMPONENT_ALARM_TRIGGER_RELATIVE_START) {
+    int relSecs = 0;
+    if (trigger) {
+        struct icaltriggertype value = icalproperty_get_trigger(trigger);
+        icalparameter *related = icalproperty_get_first_parameter(trigger, ICAL_RELATED_PARAMETER);
+        if (icaltime_is_null_time(value.time) &&
+            (!related || (icalparameter_get_related(related) == ICAL_RELATED_START))) {
 
-            relSecs = - icaldurationtype_as_int(trigger.u.rel_duration);
+            relSecs = - icaldurationtype_as_int(value.duration);
             if (relSecs < 0) {
                 //WORKAROUND: Print warning only once, avoid flood application output
                 static bool relativeStartwarningPrinted = false;
                 relSecs = 0;
                 if (!relativeStartwarningPrinted) {
-                    fail = true;
                     relativeStartwarningPrinted = true;
                     qWarning() << "QOrganizer does not support triggers after event start";
+                    return;
                 }
             }
-        } else if (trigger.type != E_CAL_COMPONENT_ALARM_TRIGGER_NONE) {
-            fail = true;
+        } else {
             //WORKAROUND: Print warning only once, avoid flood application output
             static bool warningPrinted = false;
             if (!warningPrinted) {
-                qWarning() << "QOrganizer only supports triggers relative to event start.:" << trigger.type;
+                qWarning() << "QOrganizer only supports triggers relative to event start.:"
+                           << icalproperty_as_ical_string(trigger);
                 warningPrinted = true;
             }
+            return;
         }
+    }
+
+    // the details live on the stack, saveDetail() keeps its own copy
+    QUrl attachUrl = attach ? dencodeAttachment(attach) : QUrl();
+    auto saveReminder = [&](QOrganizerItemReminder *aDetail) {
+        aDetail->setSecondsBeforeStart(relSecs);
+        // the repetition needs both the count and the interval
+        if (repeat && duration) {
+            aDetail->setRepetition(icalproperty_get_repeat(repeat),
+                                   icaldurationtype_as_int(icalproperty_get_duration(duration)));
+        } else {
+            aDetail->setRepetition(0, 0);
+        }
+        item->saveDetail(aDetail);
+    };
 
-        if (!fail) {
-            aDetail->setSecondsBeforeStart(relSecs);
-            ECalComponentAlarmRepeat aRepeat;
-            e_cal_component_alarm_get_repeat(alarm.data(), &aRepeat);
-            aDetail->setRepetition(aRepeat.repetitions, icaldurationtype_as_int(aRepeat.duration));
-            item->saveDetail(aDetail);
+    if (visual) {
+        QOrganizerItemVisualReminder reminder;
+        if (attachUrl.isValid()) {
+            reminder.setDataUrl(attachUrl);
+        }
+        reminder.setMessage(QString::fromUtf8(description ? icalproperty_get_description(description) : 0));
+        saveReminder(&reminder);
+    } else {
+        QOrganizerItemAudibleReminder reminder;
+        if (attachUrl.isValid()) {
+            reminder.setDataUrl(attachUrl);
         }
-        delete aDetail;
+        saveReminder(&reminder);
+    }
+}
+
+void QOrganizerEDSEngine::parseReminders(ECalComponent *comp,
+                                         QtOrganizer::QOrganizerItem *item,
+                                         QList<QtOrganizer::QOrganizerItemDetail::DetailType> detailsHint)
+{
+    icalcomponent *ical = e_cal_component_get_icalcomponent(comp);
+    for (icalcomponent *alarm = icalcomponent_get_first_component(ical, ICAL_VALARM_COMPONENT);
+         alarm != 0;
+         alarm = icalcomponent_get_next_component(ical, ICAL_VALARM_COMPONENT)) {
+        parseReminder(alarm, item, detailsHint);
     }
-    cal_obj_uid_list_free(alarms);
 }
 
 void QOrganizerEDSEngine::parseEventsAsync(const QMap<QByteArray, GSList *> &events,
@@ -2061,18 +2244,11 @@ void QOrganizerEDSEngine::parseEventsAsync(const QMap<QByteArray, GSList *> &eve
                                            QObject *source,
                                            const QByteArray &slot)
 {
+    // the thread takes ownership of the lists, no need to copy them here
     QMap<QOrganizerCollectionId, GSList*> request;
     Q_FOREACH(const QByteArray &sourceId, events.keys()) {
-        QOrganizerCollectionId collection = d->m_sourceRegistry->collectionId(sourceId);
-        if (isIcalEvents) {
-            request.insert(collection,
-                           g_slist_copy_deep(events.value(sourceId),
-                                             (GCopyFunc) icalcomponent_new_clone, NULL));
-        } else {
-            request.insert(collection,
-                           g_slist_copy_deep(events.value(sourceId),
-                                             (GCopyFunc) g_object_ref, NULL));
-        }
+        request.insert(d->m_sourceRegistry->collectionId(sourceId),
+                       events.value(sourceId));
     }
 
     // the thread will destroy itself when done
@@ -2080,90 +2256,26 @@ void QOrganizerEDSEngine::parseEventsAsync(const QMap<QByteArray, GSList *> &eve
     thread->start(request, isIcalEvents, detailsHint);
 }
 
-QList<QOrganizerItem> QOrganizerEDSEngine::parseEvents(const QOrganizerCollectionId &collectionId, GSList *events, bool isIcalEvents, QList<QOrganizerItemDetail::DetailType> detailsHint)
+QList<QOrganizerItem> QOrganizerEDSEngine::parseEvents(const QOrganizerCollectionId &collectionId, GSList *events, bool isIcalEvents, const ParsePlan &plan)
 {
     QList<QOrganizerItem> items;
+    items.reserve(g_slist_length(events));
     for (GSList *l = events; l; l = l->next) {
-        QOrganizerItem *item;
-        ECalComponent *comp;
+        icalcomponent *ical;
         if (isIcalEvents) {
-            icalcomponent *clone = icalcomponent_new_clone(static_cast<icalcomponent*>(l->data));
-            if (clone && icalcomponent_is_valid(clone)) {
-                comp = e_cal_component_new_from_icalcomponent(clone);
-            } else {
+            ical = static_cast<icalcomponent*>(l->data);
+            if (!ical || !icalcomponent_is_valid(ical)) {
                 qWarning() << "Fail to parse event";
                 continue;
             }
         } else {
-            comp = E_CAL_COMPONENT(l->data);
-        }
-
-        //type
-        ECalComponentVType vType = e_cal_component_get_vtype(comp);
-        switch(vType) {
-            case E_CAL_COMPONENT_EVENT:
-                item = parseEvent(comp, detailsHint);
-                break;
-            case E_CAL_COMPONENT_TODO:
-                item = parseToDo(comp, detailsHint);
-                break;
-            case E_CAL_COMPONENT_JOURNAL:
-                item = parseJournal(comp, detailsHint);
-                break;
-            case E_CAL_COMPONENT_FREEBUSY:
-                qWarning() << "Component FREEBUSY not supported;";
-                continue;
-            case E_CAL_COMPONENT_TIMEZONE:
-                qWarning() << "Component TIMEZONE not supported;";
-            case E_CAL_COMPONENT_NO_TYPE:
-                continue;
-        }
-        // id is mandatory
-        parseId(comp, item, collectionId);
-
-        if (detailsHint.isEmpty() ||
-            detailsHint.contains(QOrganizerItemDetail::TypeDescription)) {
-            parseDescription(comp, item);
-        }
-
-        if (detailsHint.isEmpty() ||
-            detailsHint.contains(QOrganizerItemDetail::TypeDisplayLabel)) {
-            parseSummary(comp, item);
-        }
-
-        if (detailsHint.isEmpty() ||
-            detailsHint.contains(QOrganizerItemDetail::TypeComment)) {
-            parseComments(comp, item);
+            ical = e_cal_component_get_icalcomponent(E_CAL_COMPONENT(l->data));
         }
 
-        if (detailsHint.isEmpty() ||
-            detailsHint.contains(QOrganizerItemDetail::TypeTag)) {
-            parseTags(comp, item);
-        }
-
-        if (detailsHint.isEmpty() ||
-            detailsHint.contains(QOrganizerItemDetail::TypeReminder) ||
-            detailsHint.contains(QOrganizerItemDetail::TypeVisualReminder) ||
-            detailsHint.contains(QOrganizerItemDetail::TypeAudibleReminder) ||
-            detailsHint.contains(QOrganizerItemDetail::TypeEmailReminder)) {
-            parseReminders(comp, item, detailsHint);
-        }
-
-        if (detailsHint.isEmpty() ||
-            detailsHint.contains(QOrganizerItemDetail::TypeEventAttendee)) {
-            parseAttendeeList(comp, item);
-        }
-
-        if (detailsHint.isEmpty() ||
-            detailsHint.contains(QOrganizerItemDetail::TypeExtendedDetail)) {
-            parseExtendedDetails(comp, item);
-        }
-
-        items << *item;
-        delete item;
-
-        if (isIcalEvents) {
-            g_object_unref(comp);
+        // build the item in its place in the list
+        items.append(QOrganizerItem());
+        if (!plan.parse(ical, collectionId, &items.last())) {
+            items.removeLast();
         }
     }
     return items;
@@ -2172,10 +2284,10 @@ QList<QOrganizerItem> QOrganizerEDSEngine::parseEvents(const QOrganizerCollectio
 QList<QOrganizerItem> QOrganizerEDSEngine::parseEvents(const QByteArray &sourceId,
                                                        GSList *events,
                                                        bool isIcalEvents,
-                                                       QList<QOrganizerItemDetail::DetailType> detailsHint)
+                                                       const ParsePlan &plan)
 {
     QOrganizerCollectionId collection(managerUri(), sourceId);
-    return parseEvents(collection, events, isIcalEvents, detailsHint);
+    return parseEvents(collection, events, isIcalEvents, plan);
 }
 
 void QOrganizerEDSEngine::parseStartTime(const QOrganizerItem &item, ECalComponent *comp)
@@ -2526,29 +2638,27 @@ void QOrganizerEDSEngine::parseExtendedDetails(const QOrganizerItem &item, ECalC
     }
 }
 
-bool QOrganizerEDSEngine::hasRecurrence(ECalComponent *comp)
+QByteArray QOrganizerEDSEngine::recurrenceId(icalproperty *prop)
 {
-    char *rid = e_cal_component_get_recurid_as_string(comp);
-    bool result = (rid && strcmp(rid, "0"));
-    if (rid) {
-        free(rid);
+    // same format as e_cal_component_get_recurid_as_string()
+    struct icaltimetype rid = icalproperty_get_recurrenceid(prop);
+    if (icaltime_is_null_time(rid)) {
+        return QByteArray("0");
     }
-    return result;
+    return QByteArray(icaltime_as_ical_string(rid));
 }
 
-void QOrganizerEDSEngine::parseId(ECalComponent *comp,
+void QOrganizerEDSEngine::parseId(const QByteArray &uid,
+                                  const QByteArray &rId,
                                   QOrganizerItem *item,
                                   const QOrganizerCollectionId &collectionId)
 {
-    ECalComponentId *id = e_cal_component_get_id(comp);
-
     if (collectionId.isNull()) {
         qWarning() << "Parse Id with null collection";
         return;
     }
 
-    QByteArray iId(id->uid);
-    QByteArray rId(id->rid);
+    QByteArray iId(uid);
     if (!rId.isEmpty()) {
         iId += "#" + rId;
     }
@@ -2561,13 +2671,12 @@ void QOrganizerEDSEngine::parseId(ECalComponent *comp,
 
     if (!rId.isEmpty()) {
         QOrganizerItemParent itemParent = item->detail(QOrganizerItemDetail::TypeParent);
-        QOrganizerItemId parentId(idFromEds(collectionId, QByteArray(id->uid)));
+        QOrganizerItemId parentId(idFromEds(collectionId, uid));
         itemParent.setParentId(parentId);
         item->saveDetail(&itemParent);
     }
 
     item->setCollectionId(collectionId);
-    e_cal_component_free_id(id);
 }
 
 ECalComponent *QOrganizerEDSEngine::createDefaultComponent(ECalClient *client,
@@ -2775,19 +2884,21 @@ void QOrganizerEDSEngine::parseReminders(const QOrganizerItem &item, ECalCompone
 
 QOrganizerItemId
 QOrganizerEDSEngine::idFromEds(const QOrganizerCollectionId &collectionId,
-                               const gchar *uid)
+                               const QByteArray &uid)
 {
     return QOrganizerItemId(collectionId.managerUri(),
-                            collectionId.localId() + '/' + QByteArray(uid));
+                            ItemIdPool::localId(collectionId.localId(), uid));
 }
 
 QByteArray QOrganizerEDSEngine::idToEds(const QOrganizerItemId &itemId,
                                         QByteArray *sourceId)
 {
-    QList<QByteArray> ids = itemId.localId().split('/');
-    if (ids.length() == 2) {
-        if (sourceId) *sourceId = ids[0];
-        return ids[1];
+    // source ids never contain '/', uids may
+    const QByteArray localId = itemId.localId();
+    int separator = localId.indexOf('/');
+    if (separator > 0) {
+        if (sourceId) *sourceId = localId.left(separator);
+        return localId.mid(separator + 1);
     } else {
         if (sourceId) *sourceId = QByteArray();
         return QByteArray();
@@ -20,6 +20,7 @@
 #define QORGANIZER_EDS_ENGINE_H
 
 #include <QExplicitlySharedDataPointer>
+#include <QSet>
 
 #include <QtOrganizer/QOrganizerCollectionId>
 #include <QtOrganizer/QOrganizerItemId>
@@ -35,6 +36,8 @@
 
 #include <libecal/libecal.h>
 
+#include "qorganizer-eds-parseplan.h"
+
 class RequestData;
 class FetchRequestData;
 class FetchByIdRequestData;
@@ -45,6 +48,8 @@ class RemoveByIdRequestData;
 class SaveCollectionRequestData;
 class RemoveCollectionRequestData;
 class ViewWatcher;
+class SharedFetch;
+class FetchSubscriberData;
 class QOrganizerEDSEngineData;
 
 class QOrganizerEDSEngine : public QtOrganizer::QOrganizerManagerEngine
@@ -52,6 +57,16 @@ class QOrganizerEDSEngine : public QtOrganizer::QOrganizerManagerEngine
     Q_OBJECT
 
 public:
+    /* The parameters are listed in qorganizer-eds-enginedata.h.
+     *
+     * With EDS_FREE_BUSY_PARAMETER set to "true", a fetch over a date range
+     * whose hint asks for QOrganizerItemDetail::TypeEventTime only gets the
+     * busy periods instead of the events: one QOrganizerEvent with a null
+     * id per period, carrying the collection id and the start and end of
+     * the merged event instances, clipped to the range. Cancelled and
+     * transparent events and all tasks are not busy. The request filter is
+     * tested against the periods and maxCount limits how many are returned.
+     */
     static QOrganizerEDSEngine *createEDSEngine(const QMap<QString, QString>& parameters);
 
     ~QOrganizerEDSEngine();
@@ -128,12 +143,13 @@ public:
      */
     static QtOrganizer::QOrganizerItemId
         idFromEds(const QtOrganizer::QOrganizerCollectionId &collectionId,
-                  const gchar *uid);
+                  const QByteArray &uid);
     static QByteArray idToEds(const QtOrganizer::QOrganizerItemId &itemId,
                               QByteArray *sourceId = nullptr);
 
     // debug
     int runningRequestCount() const;
+    bool isWatching(const QtOrganizer::QOrganizerCollectionId &collectionId) const;
 
 protected Q_SLOTS:
     void onSourceAdded(const QByteArray &sourceId);
@@ -143,18 +159,30 @@ protected Q_SLOTS:
 protected:
     QOrganizerEDSEngine(QOrganizerEDSEngineData *data);
 
+    // runs the request without spinning the Qt event loop
+    Q_INVOKABLE void runRequestSync(QtOrganizer::QOrganizerAbstractRequest *req);
+
 private:
     static QOrganizerEDSEngineData *m_globalData;
     QOrganizerEDSEngineData *d;
     QMap<QtOrganizer::QOrganizerAbstractRequest*, RequestData*> m_runningRequests;
+    // requests being run by runRequestSync()
+    QSet<QtOrganizer::QOrganizerAbstractRequest*> m_syncRequests;
+    bool m_freeBusy;
+
+    QByteArrayList requestSourceIds(QtOrganizer::QOrganizerAbstractRequest *req) const;
+    void prepareRequest(QtOrganizer::QOrganizerAbstractRequest *req);
+    void dispatchRequest(QtOrganizer::QOrganizerAbstractRequest *req);
+    // a write changes the collections of the request
+    void invalidateCaches(QtOrganizer::QOrganizerAbstractRequest *req);
 
-    QList<QtOrganizer::QOrganizerItem> parseEvents(const QByteArray &sourceId, GSList *events, bool isIcalEvents, QList<QtOrganizer::QOrganizerItemDetail::DetailType> detailsHint);
+    QList<QtOrganizer::QOrganizerItem> parseEvents(const QByteArray &sourceId, GSList *events, bool isIcalEvents, const ParsePlan &plan);
     void parseEventsAsync(const QMap<QByteArray, GSList *> &events,
                           bool isIcalEvents,
                           QList<QtOrganizer::QOrganizerItemDetail::DetailType> detailsHint,
                           QObject *source,
                           const QByteArray &slot);
-    static QList<QtOrganizer::QOrganizerItem> parseEvents(const QtOrganizer::QOrganizerCollectionId &collectionId, GSList *events, bool isIcalEvents, QList<QtOrganizer::QOrganizerItemDetail::DetailType> detailsHint);
+    static QList<QtOrganizer::QOrganizerItem> parseEvents(const QtOrganizer::QOrganizerCollectionId &collectionId, GSList *events, bool isIcalEvents, const ParsePlan &plan);
     static GSList *parseItems(ECalClient *client, QList<QtOrganizer::QOrganizerItem> items, bool *hasRecurrence);
 
     // QOrganizerItem -> ECalComponent
@@ -182,39 +210,42 @@ private:
     static void parseAttendeeList(const QtOrganizer::QOrganizerItem &item, ECalComponent *comp);
     static void parseExtendedDetails(const QtOrganizer::QOrganizerItem &item, ECalComponent *comp);
 
+    // icalcomponent -> QOrganizerItem
+    static QByteArray recurrenceId(icalproperty *prop);
+    static void parseId(const QByteArray &uid, const QByteArray &rId, QtOrganizer::QOrganizerItem *item, const QtOrganizer::QOrganizerCollectionId &edsCollectionId);
+    static void parseSummary(icalproperty *prop, QtOrganizer::QOrganizerItem *item);
+    static void parseDescription(icalproperty *prop, QtOrganizer::QOrganizerItem *item);
+    static void parseComment(icalproperty *prop, QtOrganizer::QOrganizerItem *item);
+    static void parseTags(icalproperty *prop, QtOrganizer::QOrganizerItem *item);
+    static void parseReminder(icalcomponent *alarm, QtOrganizer::QOrganizerItem *item, QList<QtOrganizer::QOrganizerItemDetail::DetailType> detailsHint);
+    static QUrl dencodeAttachment(icalproperty *prop);
+    static void parseStartTime(icalproperty *prop, QtOrganizer::QOrganizerItem *item);
+    static void parseTodoStartTime(icalproperty *prop, QtOrganizer::QOrganizerItem *item);
+    static void parseEndTime(icalproperty *prop, QtOrganizer::QOrganizerItem *item);
+    static void parseJournalTime(icalproperty *prop, QtOrganizer::QOrganizerItem *item);
+    static void parseRecurrenceDate(icalproperty *prop, QtOrganizer::QOrganizerItem *item);
+    static void parseExceptionDate(icalproperty *prop, QtOrganizer::QOrganizerItem *item);
+    static void parseRecurrenceRule(icalproperty *prop, QtOrganizer::QOrganizerItem *item);
+    static void parseWeekRecurrence(struct icalrecurrencetype *rule, QtOrganizer::QOrganizerRecurrenceRule *qRule);
+    static void parseMonthRecurrence(struct icalrecurrencetype *rule, QtOrganizer::QOrganizerRecurrenceRule *qRule);
+    static void parseYearRecurrence(struct icalrecurrencetype *rule, QtOrganizer::QOrganizerRecurrenceRule *qRule);
+    static void parsePriority(icalproperty *prop, QtOrganizer::QOrganizerItem *item);
+    static void parseLocation(icalproperty *prop, QtOrganizer::QOrganizerItem *item);
+    static void parseDueDate(icalproperty *prop, QtOrganizer::QOrganizerItem *item);
+    static void parseProgress(icalproperty *prop, QtOrganizer::QOrganizerItem *item);
+    static void parseStatus(icalproperty_status status, QtOrganizer::QOrganizerItem *item);
+    static void parseAttendee(icalproperty *prop, QtOrganizer::QOrganizerItem *item);
+    static void parseExtendedDetail(icalproperty *prop, QtOrganizer::QOrganizerItem *item);
+
     // ECalComponent -> QOrganizerItem
-    static bool hasRecurrence(ECalComponent *comp);
-    static void parseId(ECalComponent *comp, QtOrganizer::QOrganizerItem *item, const QtOrganizer::QOrganizerCollectionId &edsCollectionId);
-    static void parseSummary(ECalComponent *comp, QtOrganizer::QOrganizerItem *item);
-    static void parseDescription(ECalComponent *comp, QtOrganizer::QOrganizerItem *item);
-    static void parseComments(ECalComponent *comp, QtOrganizer::QOrganizerItem *item);
-    static void parseTags(ECalComponent *comp, QtOrganizer::QOrganizerItem *item);
-    static void parseReminders(ECalComponent *comp, QtOrganizer::QOrganizerItem *item, QList<QtOrganizer::QOrganizerItemDetail::DetailType> detailsHint = QList<QtOrganizer::QOrganizerItemDetail::DetailType>());
-    static QUrl dencodeAttachment(ECalComponentAlarm *alarm);
-    static void parseAudibleReminderAttachment(ECalComponentAlarm *alarm, QtOrganizer::QOrganizerItemReminder *aDetail);
-    static void parseVisualReminderAttachment(ECalComponentAlarm *alarm, QtOrganizer::QOrganizerItemReminder *aDetail);
     static void parseStartTime(ECalComponent *comp, QtOrganizer::QOrganizerItem *item);
-    static void parseTodoStartTime(ECalComponent *comp, QtOrganizer::QOrganizerItem *item);
     static void parseEndTime(ECalComponent *comp, QtOrganizer::QOrganizerItem *item);
     static void parseRecurrence(ECalComponent *comp, QtOrganizer::QOrganizerItem *item);
-    static void parseWeekRecurrence(struct icalrecurrencetype *rule, QtOrganizer::QOrganizerRecurrenceRule *qRule);
-    static void parseMonthRecurrence(struct icalrecurrencetype *rule, QtOrganizer::QOrganizerRecurrenceRule *qRule);
-    static void parseYearRecurrence(struct icalrecurrencetype *rule, QtOrganizer::QOrganizerRecurrenceRule *qRule);
-    static void parsePriority(ECalComponent *comp, QtOrganizer::QOrganizerItem *item);
-    static void parseLocation(ECalComponent *comp, QtOrganizer::QOrganizerItem *item);
-    static void parseDueDate(ECalComponent *comp, QtOrganizer::QOrganizerItem *item);
-    static void parseProgress(ECalComponent *comp, QtOrganizer::QOrganizerItem *item);
-    static void parseStatus(ECalComponent *comp, QtOrganizer::QOrganizerItem *item);
-    static void parseAttendeeList(ECalComponent *comp, QtOrganizer::QOrganizerItem *item);
-    static void parseExtendedDetails(ECalComponent *comp, QtOrganizer::QOrganizerItem *item);
+    static void parseReminders(ECalComponent *comp, QtOrganizer::QOrganizerItem *item, QList<QtOrganizer::QOrganizerItemDetail::DetailType> detailsHint = QList<QtOrganizer::QOrganizerItemDetail::DetailType>());
 
     static QDateTime fromIcalTime(struct icaltimetype value, const char *tzId);
     static icaltimetype fromQDateTime(const QDateTime &dateTime, bool allDay, QByteArray *tzId);
 
-    static QtOrganizer::QOrganizerItem *parseEvent(ECalComponent *comp, QList<QtOrganizer::QOrganizerItemDetail::DetailType> detailsHint);
-    static QtOrganizer::QOrganizerItem *parseToDo(ECalComponent *comp, QList<QtOrganizer::QOrganizerItemDetail::DetailType> detailsHint);
-    static QtOrganizer::QOrganizerItem *parseJournal(ECalComponent *comp, QList<QtOrganizer::QOrganizerItemDetail::DetailType> detailsHint);
-
     static ECalComponent *createDefaultComponent(ECalClient *client, icalcomponent_kind iKind, ECalComponentVType eType);
     static ECalComponent *parseEventItem(ECalClient *client, const QtOrganizer::QOrganizerItem &item);
     static ECalComponent *parseTodoItem(ECalClient *client, const QtOrganizer::QOrganizerItem &item);
@@ -224,10 +255,15 @@ private:
 
     // glib callback
     void itemsAsync(QtOrganizer::QOrganizerItemFetchRequest *req);
+    void itemsAsyncFetch(QtOrganizer::QOrganizerItemFetchRequest *req, bool prefetch = false);
     static void itemsAsyncStart(FetchRequestData *data);
+    static gboolean itemsAsyncCached(FetchSubscriberData *data);
+    static gboolean itemsAsyncList(FetchRequestData *data);
+    static void itemsAsyncListGap(FetchRequestData *data);
+    static gboolean itemsAsyncListDone(FetchRequestData *data);
     static gboolean itemsAsyncListed(ECalComponent *comp, time_t instanceStart, time_t instanceEnd, FetchRequestData *data);
     static void itemsAsyncDone(FetchRequestData *data);
-    static void itemsAsyncListedAsComps(GObject *source, GAsyncResult *res, FetchRequestData *data);
+    static void itemsAsyncListedObjects(GObject *source, GAsyncResult *res, FetchRequestData *data);
     static void itemsAsyncFetchDeatachedItems(FetchRequestData *data);
     static void itemsAsyncListByIdListed(GObject *source, GAsyncResult *res, FetchRequestData *data);
 
@@ -270,6 +306,9 @@ private:
     friend class QOrganizerParseEventThread;
     friend class RemoveByIdRequestData;
     friend class RemoveRequestData;
+    friend class SharedFetch;
+    friend class Prefetcher;
+    friend class ParsePlan;
 };
 
 //FIXME: Do we really need this, this looks wrong
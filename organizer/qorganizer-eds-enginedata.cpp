@@ -19,11 +19,48 @@
 #include "qorganizer-eds-enginedata.h"
 #include "qorganizer-eds-viewwatcher.h"
 #include "qorganizer-eds-source-registry.h"
+#include "qorganizer-eds-iothread.h"
+#include "qorganizer-eds-requestscheduler.h"
+#include "qorganizer-eds-instancecache.h"
+#include "qorganizer-eds-prefetcher.h"
+
+// Views which were not used for this long are closed, the next request on
+// the collection opens them again
+#define VIEW_WATCHER_IDLE_TIMEOUT   (5 * 60 * 1000)
+
+// Item changes are coalesced before being emitted: isolated changes wait a
+// little, bursts are batched for longer but never beyond the latency cap, and
+// really big bursts are reported as a single dataChanged()
+#define ITEM_CHANGES_DELAY          50
+#define ITEM_CHANGES_BURST_DELAY    250
+#define ITEM_CHANGES_MAX_LATENCY    1000
+#define ITEM_CHANGES_BURST_SIZE     50
+#define ITEM_CHANGES_COLLAPSE_SIZE  2000
+
+// Number of fetch results kept around for the next identical request
+#define FETCH_RESULTS_CACHE_SIZE    16
 
 QOrganizerEDSEngineData::QOrganizerEDSEngineData()
     : QSharedData(),
-      m_sourceRegistry(0)
+      m_sourceRegistry(0),
+      m_ioThread(new QOrganizerEDSIOThread),
+      m_scheduler(new RequestScheduler),
+      m_instanceCache(new InstanceCache),
+      m_prefetcher(0),
+      m_watchIdsOnly(false),
+      m_watchWindow(0),
+      m_pendingItemChanges(0),
+      m_fetchResultsGeneration(0)
 {
+    m_idleWatchersTimer.setInterval(VIEW_WATCHER_IDLE_TIMEOUT / 2);
+    QObject::connect(&m_idleWatchersTimer, &QTimer::timeout, [this]() {
+        releaseIdleWatchers();
+    });
+
+    m_itemChangesTimer.setSingleShot(true);
+    QObject::connect(&m_itemChangesTimer, &QTimer::timeout, [this]() {
+        flushItemChanges();
+    });
 }
 
 QOrganizerEDSEngineData::QOrganizerEDSEngineData(const QOrganizerEDSEngineData& other)
@@ -36,6 +73,18 @@ QOrganizerEDSEngineData::~QOrganizerEDSEngineData()
     qDeleteAll(m_viewWatchers);
     m_viewWatchers.clear();
 
+    delete m_ioThread;
+    m_ioThread = 0;
+
+    delete m_scheduler;
+    m_scheduler = 0;
+
+    delete m_prefetcher;
+    m_prefetcher = 0;
+
+    delete m_instanceCache;
+    m_instanceCache = 0;
+
     if (m_sourceRegistry) {
         m_sourceRegistry->deleteLater();
         m_sourceRegistry = 0;
@@ -45,13 +94,16 @@ QOrganizerEDSEngineData::~QOrganizerEDSEngineData()
 ViewWatcher* QOrganizerEDSEngineData::watch(const QOrganizerCollectionId &collectionId)
 {
     QByteArray sourceId = collectionId.localId();
-    ViewWatcher *vw = m_viewWatchers[sourceId];
+    ViewWatcher *vw = m_viewWatchers.value(sourceId, 0);
     if (!vw) {
-        EClient *client = m_sourceRegistry->client(sourceId);
-        vw = new ViewWatcher(collectionId, this, client);
+        vw = new ViewWatcher(collectionId, this);
         m_viewWatchers.insert(sourceId, vw);
-        g_object_unref(client);
+
+        if (!m_idleWatchersTimer.isActive()) {
+            m_idleWatchersTimer.start();
+        }
     }
+    vw->touch();
     return vw;
 }
 
@@ -60,5 +112,144 @@ void QOrganizerEDSEngineData::unWatch(const QByteArray &sourceId)
     ViewWatcher *viewW = m_viewWatchers.take(sourceId);
     if (viewW) {
         delete viewW;
+        // nobody reports the changes of the source anymore
+        invalidateFetchResults();
     }
+
+    if (m_viewWatchers.isEmpty()) {
+        m_idleWatchersTimer.stop();
+    }
+}
+
+void QOrganizerEDSEngineData::releaseIdleWatchers()
+{
+    Q_FOREACH(const QByteArray &sourceId, m_viewWatchers.keys()) {
+        if (m_viewWatchers.value(sourceId)->idleTime() > VIEW_WATCHER_IDLE_TIMEOUT) {
+            unWatch(sourceId);
+        }
+    }
+}
+
+bool QOrganizerEDSEngineData::isWatching(const QByteArrayList &sourceIds) const
+{
+    Q_FOREACH(const QByteArray &sourceId, sourceIds) {
+        ViewWatcher *vw = m_viewWatchers.value(sourceId, 0);
+        if (!vw || !vw->isRunning()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void QOrganizerEDSEngineData::notifyItemsAdded(const QList<QOrganizerItemId> &itemIds)
+{
+    if (scheduleItemChanges(itemIds.count())) {
+        m_itemChanges.insertAddedItems(itemIds);
+    }
+}
+
+void QOrganizerEDSEngineData::notifyItemsChanged(const QList<QOrganizerItemId> &itemIds,
+                                                 const QList<QOrganizerItemDetail::DetailType> &typesChanged)
+{
+    if (scheduleItemChanges(itemIds.count())) {
+        m_itemChanges.insertChangedItems(itemIds, typesChanged);
+    }
+}
+
+void QOrganizerEDSEngineData::notifyItemsRemoved(const QList<QOrganizerItemId> &itemIds)
+{
+    if (scheduleItemChanges(itemIds.count())) {
+        m_itemChanges.insertRemovedItems(itemIds);
+    }
+}
+
+void QOrganizerEDSEngineData::flushItemChanges()
+{
+    m_itemChangesTimer.stop();
+    m_pendingItemChanges = 0;
+    emitSharedSignals(&m_itemChanges);
+    m_itemChanges.clearAll();
+}
+
+bool QOrganizerEDSEngineData::scheduleItemChanges(int count)
+{
+    invalidateFetchResults();
+
+    if (m_pendingItemChanges == 0) {
+        m_itemChangesAge.start();
+    }
+    m_pendingItemChanges += count;
+
+    qint64 remaining = ITEM_CHANGES_MAX_LATENCY - m_itemChangesAge.elapsed();
+    if (m_pendingItemChanges < ITEM_CHANGES_BURST_SIZE) {
+        m_itemChangesTimer.start(qMax<qint64>(0, qMin<qint64>(ITEM_CHANGES_DELAY, remaining)));
+    } else {
+        m_itemChangesTimer.start(qMax<qint64>(0, qMin<qint64>(ITEM_CHANGES_BURST_DELAY, remaining)));
+    }
+
+    // too many changes to be useful, ask the clients to reload everything
+    if (m_itemChanges.dataChanged()) {
+        return false;
+    } else if (m_pendingItemChanges > ITEM_CHANGES_COLLAPSE_SIZE) {
+        m_itemChanges.clearAll();
+        m_itemChanges.setDataChanged(true);
+        return false;
+    }
+    return true;
+}
+
+bool QOrganizerEDSEngineData::canCacheFetchResults(const QByteArrayList &sourceIds) const
+{
+    // a windowed view does not report the changes outside of the window
+    return (m_watchWindow <= 0) && isWatching(sourceIds);
+}
+
+bool QOrganizerEDSEngineData::fetchResults(const QByteArray &key,
+                                           const QByteArrayList &sourceIds,
+                                           QList<QOrganizerItem> *items)
+{
+    if (!canCacheFetchResults(sourceIds)) {
+        return false;
+    }
+
+    QHash<QByteArray, QList<QOrganizerItem> >::const_iterator i = m_fetchResults.constFind(key);
+    if (i == m_fetchResults.constEnd()) {
+        return false;
+    }
+
+    *items = i.value();
+    m_fetchResultsOrder.removeOne(key);
+    m_fetchResultsOrder.append(key);
+    return true;
+}
+
+void QOrganizerEDSEngineData::storeFetchResults(const QByteArray &key,
+                                                const QByteArrayList &sourceIds,
+                                                const QList<QOrganizerItem> &items,
+                                                uint generation)
+{
+    // something changed while the fetch was running
+    if ((generation != m_fetchResultsGeneration) || !canCacheFetchResults(sourceIds)) {
+        return;
+    }
+
+    if (!m_fetchResults.contains(key)) {
+        while (m_fetchResultsOrder.size() >= FETCH_RESULTS_CACHE_SIZE) {
+            m_fetchResults.remove(m_fetchResultsOrder.takeFirst());
+        }
+        m_fetchResultsOrder.append(key);
+    }
+    m_fetchResults.insert(key, items);
+}
+
+void QOrganizerEDSEngineData::invalidateFetchResults()
+{
+    m_fetchResultsGeneration++;
+    m_fetchResults.clear();
+    m_fetchResultsOrder.clear();
+}
+
+uint QOrganizerEDSEngineData::fetchResultsGeneration() const
+{
+    return m_fetchResultsGeneration;
 }
@@ -20,16 +20,33 @@
 #define __QORGANIZER_EDS_ENGINEDATA_H__
 
 #include <QSharedData>
+#include <QByteArrayList>
 #include <QMap>
+#include <QHash>
+#include <QTimer>
+#include <QElapsedTimer>
 
 #include <QtOrganizer/QOrganizerAbstractRequest>
 #include <QtOrganizer/QOrganizerManagerEngine>
 #include <QtOrganizer/QOrganizerItemChangeSet>
+#include <QtOrganizer/QOrganizerItemDetail>
+#include <QtOrganizer/QOrganizerItem>
 #include <QtOrganizer/QOrganizerCollectionChangeSet>
 
+// engine parameters
+#define EDS_WATCHER_MODE_PARAMETER      "watcherMode"    // "full" (default) or "ids"
+#define EDS_WATCHER_WINDOW_PARAMETER    "watcherWindow"  // days around today, 0 watches everything
+#define EDS_PREFETCH_PARAMETER          "prefetch"       // "true" lists the neighbour ranges of every fetch
+#define EDS_FREE_BUSY_PARAMETER         "freeBusy"       // "true" answers event time fetches with busy periods
+
 class SourceRegistry;
 class ViewWatcher;
+class QOrganizerEDSIOThread;
+class RequestScheduler;
+class InstanceCache;
+class Prefetcher;
 class RequestData;
+class SharedFetch;
 
 class QOrganizerEDSEngineData : public QSharedData
 {
@@ -48,13 +65,53 @@ public:
 
     ViewWatcher* watch(const QtOrganizer::QOrganizerCollectionId &collectionId);
     void unWatch(const QByteArray &sourceId);
+    void releaseIdleWatchers();
+    // true if the changes of every source are being reported
+    bool isWatching(const QByteArrayList &sourceIds) const;
+
+    // changes reported by the watchers are emitted together
+    void notifyItemsAdded(const QList<QtOrganizer::QOrganizerItemId> &itemIds);
+    void notifyItemsChanged(const QList<QtOrganizer::QOrganizerItemId> &itemIds,
+                            const QList<QtOrganizer::QOrganizerItemDetail::DetailType> &typesChanged);
+    void notifyItemsRemoved(const QList<QtOrganizer::QOrganizerItemId> &itemIds);
+    void flushItemChanges();
+
+    // results of the last fetches, shared by all engines; only kept while
+    // every change of the sources is reported
+    bool canCacheFetchResults(const QByteArrayList &sourceIds) const;
+    bool fetchResults(const QByteArray &key,
+                      const QByteArrayList &sourceIds,
+                      QList<QtOrganizer::QOrganizerItem> *items);
+    void storeFetchResults(const QByteArray &key,
+                           const QByteArrayList &sourceIds,
+                           const QList<QtOrganizer::QOrganizerItem> &items,
+                           uint generation);
+    void invalidateFetchResults();
+    uint fetchResultsGeneration() const;
 
     QAtomicInt m_refCount;
     SourceRegistry *m_sourceRegistry;
+    QOrganizerEDSIOThread *m_ioThread;
+    RequestScheduler *m_scheduler;
+    InstanceCache *m_instanceCache;
+    Prefetcher *m_prefetcher;
+    bool m_watchIdsOnly;
+    int m_watchWindow;
     QSet<QtOrganizer::QOrganizerManagerEngine*> m_sharedEngines;
+    QHash<QByteArray, SharedFetch*> m_sharedFetches;
 
 private:
     QMap<QByteArray, ViewWatcher*> m_viewWatchers;
+    QTimer m_idleWatchersTimer;
+    QtOrganizer::QOrganizerItemChangeSet m_itemChanges;
+    QTimer m_itemChangesTimer;
+    QElapsedTimer m_itemChangesAge;
+    int m_pendingItemChanges;
+    QHash<QByteArray, QList<QtOrganizer::QOrganizerItem> > m_fetchResults;
+    QList<QByteArray> m_fetchResultsOrder;
+    uint m_fetchResultsGeneration;
+
+    bool scheduleItemChanges(int count);
 
 };
 
@@ -17,10 +17,13 @@
  */
 
 #include "qorganizer-eds-fetchrequestdata.h"
+#include "qorganizer-eds-source-registry.h"
+#include "qorganizer-eds-prefetcher.h"
 
 #include <QtCore/QDebug>
 
 #include <QtOrganizer/QOrganizerItemFetchRequest>
+#include <QtOrganizer/QOrganizerEvent>
 #include <QtOrganizer/QOrganizerItemCollectionFilter>
 #include <QtOrganizer/QOrganizerItemUnionFilter>
 #include <QtOrganizer/QOrganizerItemIntersectionFilter>
@@ -32,16 +35,52 @@ FetchRequestData::FetchRequestData(QOrganizerEDSEngine *engine,
                                    QOrganizerAbstractRequest *req)
     : RequestData(engine, req),
       m_parseListener(0),
-      m_currentComponents(0)
+      m_currentComponents(0),
+      m_listInterval(false),
+      m_listStart(0),
+      m_listEnd(0),
+      m_listError(QOrganizerManager::NoError),
+      m_listing(false),
+      m_preempted(false),
+      m_prefetch(false),
+      m_freeBusy(false),
+      m_useInstanceCache(false),
+      m_instanceCache(0),
+      m_gapsGeneration(0),
+      m_listedComponents(0),
+      m_cachedComponents(0)
 {
     // filter collections related with the query
-    m_sourceIds = filterSourceIds(sourceIds);
+    m_sourceIds = filterSourceIds(sourceIds, request<QOrganizerItemFetchRequest>()->filter());
+
+    if (filterIsValid()) {
+        m_listInterval = hasDateInterval();
+        if (m_listInterval) {
+            m_listStart = startDate();
+            m_listEnd = endDate();
+            // without changes reported for every date the cache would go
+            // stale; it lives as long as the I/O thread
+            if (engine->d->m_watchWindow <= 0) {
+                m_instanceCache = engine->d->m_instanceCache;
+            }
+            m_freeBusy = engine->m_freeBusy &&
+                         (request<QOrganizerItemFetchRequest>()->fetchHint().detailTypesHint() ==
+                          (QList<QOrganizerItemDetail::DetailType>() << QOrganizerItemDetail::TypeEventTime));
+        } else {
+            m_listQuery = dateFilter().toUtf8();
+        }
+    }
 }
 
 FetchRequestData::~FetchRequestData()
 {
+    QObject::disconnect(m_clientReadyConnection);
     delete m_parseListener;
 
+    g_slist_free_full(m_currentComponents, (GDestroyNotify) icalcomponent_free);
+    g_slist_free_full(m_listedComponents, (GDestroyNotify) icalcomponent_free);
+    g_slist_free_full(m_cachedComponents, (GDestroyNotify) icalcomponent_free);
+
     Q_FOREACH(GSList *components, m_components.values()) {
         g_slist_free_full(components, (GDestroyNotify)icalcomponent_free);
     }
@@ -57,13 +96,47 @@ QByteArray FetchRequestData::nextSourceId()
     m_current = "";
     setClient(0);
     if (m_sourceIds.size()) {
-        m_current = m_sourceIds.takeFirst();
+        // prefer the sources which do not need to wait for the backend
+        SourceRegistry *registry = parent()->d->m_sourceRegistry;
+        int index = 0;
+        for (int i = 0; i < m_sourceIds.size(); i++) {
+            if (registry->clientState(m_sourceIds[i]) != SourceRegistry::ClientConnecting) {
+                index = i;
+                break;
+            }
+        }
+        m_current = m_sourceIds.takeAt(index);
+        m_listSourceId = m_current;
+        // only a running view keeps the cached instances up to date
+        m_useInstanceCache = m_instanceCache &&
+                             parent()->d->isWatching(QByteArrayList() << m_current);
         return m_current;
     } else {
         return QByteArray();
     }
 }
 
+bool FetchRequestData::allSourcesConnecting() const
+{
+    if (m_sourceIds.isEmpty()) {
+        return false;
+    }
+
+    SourceRegistry *registry = parent()->d->m_sourceRegistry;
+    Q_FOREACH(const QByteArray &sourceId, m_sourceIds) {
+        if (registry->clientState(sourceId) != SourceRegistry::ClientConnecting) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void FetchRequestData::setClientReadyConnection(const QMetaObject::Connection &connection)
+{
+    QObject::disconnect(m_clientReadyConnection);
+    m_clientReadyConnection = connection;
+}
+
 QByteArray FetchRequestData::nextParentId()
 {
     QByteArray nextId;
@@ -126,7 +199,69 @@ void FetchRequestData::cancel()
         delete m_parseListener;
         m_parseListener = 0;
     }
+
+    // nothing is running for a queued request, no callback will release it
+    bool queued = parent() && parent()->d->m_scheduler->isQueued(this);
     RequestData::cancel();
+    if (queued) {
+        deleteLater();
+    }
+}
+
+bool FetchRequestData::preempt()
+{
+    // only the listing uses the backend
+    if (!m_listing || m_preempted) {
+        return false;
+    }
+    m_preempted = true;
+    g_cancellable_cancel(cancellable());
+    return true;
+}
+
+RequestScheduler::Priority FetchRequestData::priority() const
+{
+    return (m_listInterval && !m_prefetch) ? RequestScheduler::Visible : RequestScheduler::Background;
+}
+
+void FetchRequestData::setPrefetch(bool prefetch)
+{
+    m_prefetch = prefetch;
+}
+
+void FetchRequestData::setListing(bool listing)
+{
+    m_listing = listing;
+}
+
+bool FetchRequestData::isPreempted() const
+{
+    return m_preempted;
+}
+
+void FetchRequestData::rewindSource()
+{
+    // the sources already listed are kept, the current one starts over
+    g_slist_free_full(m_currentComponents, (GDestroyNotify) icalcomponent_free);
+    m_currentComponents = 0;
+    m_currentSpans.clear();
+    g_slist_free_full(m_listedComponents, (GDestroyNotify) icalcomponent_free);
+    m_listedComponents = 0;
+    m_listedSpans.clear();
+    g_slist_free_full(m_cachedComponents, (GDestroyNotify) icalcomponent_free);
+    m_cachedComponents = 0;
+    m_cachedSpans.clear();
+    m_busySpans.clear();
+    m_gaps.clear();
+    m_currentParentIds.clear();
+    if (!m_current.isEmpty()) {
+        m_sourceIds.prepend(m_current);
+        m_current = "";
+    }
+    setClient(0);
+    m_listError = QOrganizerManager::NoError;
+    m_preempted = false;
+    resetCancellable();
 }
 
 void FetchRequestData::compileCurrentIds()
@@ -142,7 +277,32 @@ void FetchRequestData::compileCurrentIds()
 void FetchRequestData::finish(QOrganizerManager::Error error,
                               QOrganizerAbstractRequest::State state)
 {
-    if (!m_components.isEmpty()) {
+    // parsing does not need the backends
+    if (parent()) {
+        parent()->d->m_scheduler->remove(this);
+    }
+
+    if (m_freeBusy) {
+        // nothing to parse, the periods come from the instance times
+        appendBusyPeriods();
+    }
+
+    // prefetches only fill the instance cache
+    bool parse = !m_components.isEmpty() && !m_prefetch;
+    if (parse && isSync()) {
+        // the caller is blocked anyway, there is no event loop to deliver
+        // the parse thread results
+        QOrganizerItemFetchRequest *req =  request<QOrganizerItemFetchRequest>();
+        if (req) {
+            ParsePlan plan(req->fetchHint().detailTypesHint());
+            Q_FOREACH(const QByteArray &sourceId, m_components.keys()) {
+                appendResults(parent()->parseEvents(sourceId,
+                                                    m_components.value(sourceId),
+                                                    true,
+                                                    plan));
+            }
+        }
+    } else if (parse) {
         m_parseListener = new FetchRequestDataParseListener(this,
                                                             error,
                                                             state);
@@ -153,7 +313,8 @@ void FetchRequestData::finish(QOrganizerManager::Error error,
                                        req->fetchHint().detailTypesHint(),
                                        m_parseListener,
                                        SLOT(onParseDone(QList<QtOrganizer::QOrganizerItem>)));
-
+            // owned by the parse thread now
+            m_components.clear();
             return;
         }
     }
@@ -174,6 +335,14 @@ void FetchRequestData::finishContinue(QOrganizerManager::Error error,
     m_components.clear();
 
     QOrganizerItemFetchRequest *req =  request<QOrganizerItemFetchRequest>();
+    // the next scroll will most likely ask for the neighbour ranges
+    if (req && m_listInterval && !m_prefetch && !isSync() &&
+        (state == QOrganizerAbstractRequest::FinishedState) &&
+        (error == QOrganizerManager::NoError) &&
+        parent() && parent()->d->m_prefetcher) {
+        parent()->d->m_prefetcher->prefetch(parent(), req);
+    }
+
     if (req) {
         QOrganizerManagerEngine::updateItemFetchRequest(req,
                                                         m_results,
@@ -185,9 +354,72 @@ void FetchRequestData::finishContinue(QOrganizerManager::Error error,
     RequestData::finish(error, state);
 }
 
-void FetchRequestData::appendResult(icalcomponent *comp)
+void FetchRequestData::appendInstance(icalcomponent *comp, time_t start, time_t end)
 {
     m_currentComponents = g_slist_append(m_currentComponents, comp);
+    m_currentSpans << InstanceSpan(start, end);
+}
+
+bool FetchRequestData::isFreeBusy() const
+{
+    return m_freeBusy;
+}
+
+void FetchRequestData::appendBusySpan(time_t start, time_t end)
+{
+    m_busySpans << InstanceSpan(start, end);
+}
+
+void FetchRequestData::appendBusyPeriods()
+{
+    QOrganizerItemFetchRequest *req = request<QOrganizerItemFetchRequest>();
+    if (!req || !parent()) {
+        return;
+    }
+
+    QString managerUri = parent()->managerUri();
+    QOrganizerItemFilter filter = req->filter();
+    QList<QOrganizerItemSortOrder> sorting = req->sorting();
+    Q_FOREACH(const QByteArray &sourceId, m_busy.keys()) {
+        QList<InstanceSpan> spans = m_busy.value(sourceId);
+        if (spans.isEmpty()) {
+            continue;
+        }
+        qSort(spans);
+
+        // overlapping and touching instances make a single period
+        QList<InstanceSpan> periods;
+        periods << spans.first();
+        for (int i = 1; i < spans.size(); i++) {
+            if (spans[i].first <= periods.last().second) {
+                periods.last().second = qMax(periods.last().second, spans[i].second);
+            } else {
+                periods << spans[i];
+            }
+        }
+
+        QOrganizerCollectionId collectionId(managerUri, sourceId);
+        Q_FOREACH(const InstanceSpan &period, periods) {
+            QOrganizerEvent event;
+            event.setCollectionId(collectionId);
+            event.setStartDateTime(QDateTime::fromTime_t(qMax(period.first, m_listStart)));
+            event.setEndDateTime(QDateTime::fromTime_t(qMin(period.second, m_listEnd)));
+            if (QOrganizerManagerEngine::testFilter(filter, event)) {
+                QOrganizerManagerEngine::addSorted(&m_results, event, sorting);
+            }
+        }
+    }
+    m_busy.clear();
+
+    // the first periods in the requested order are kept
+    if ((req->maxCount() > 0) && (m_results.size() > req->maxCount())) {
+        m_results = m_results.mid(0, req->maxCount());
+    }
+}
+
+void FetchRequestData::appendResults(GSList *comps)
+{
+    m_currentComponents = g_slist_concat(m_currentComponents, comps);
 }
 
 void FetchRequestData::appendDeatachedResult(icalcomponent *comp)
@@ -206,7 +438,7 @@ void FetchRequestData::appendDeatachedResult(icalcomponent *comp)
             // replace instance event
             icalcomponent_free (ical);
             e->data = icalcomponent_new_clone(comp);
-            QByteArray itemId = m_current + '/' +
+            QByteArray itemId = m_listSourceId + '/' +
                 QByteArray(uid) + '#' +
                 QByteArray(icaltime_as_ical_string(rid));
             m_deatachedIds.append(itemId);
@@ -264,12 +496,157 @@ QString FetchRequestData::dateFilter()
     return query;
 }
 
-QByteArrayList FetchRequestData::filterSourceIds(const QByteArrayList &sourceIds) const
+bool FetchRequestData::listInterval() const
+{
+    return m_listInterval;
+}
+
+time_t FetchRequestData::listStart() const
+{
+    return m_listStart;
+}
+
+time_t FetchRequestData::listEnd() const
+{
+    return m_listEnd;
+}
+
+QByteArray FetchRequestData::listQuery() const
+{
+    return m_listQuery;
+}
+
+void FetchRequestData::setListError(QOrganizerManager::Error error)
+{
+    m_listError = error;
+}
+
+QOrganizerManager::Error FetchRequestData::listError() const
+{
+    return m_listError;
+}
+
+void FetchRequestData::planGaps()
+{
+    if (!m_useInstanceCache) {
+        m_gaps << InstanceSpan(m_listStart, m_listEnd);
+        return;
+    }
+
+    m_gaps = m_instanceCache->gaps(m_listSourceId, m_listStart, m_listEnd, &m_gapsGeneration);
+    if (m_freeBusy) {
+        m_busySpans = m_instanceCache->busySpans(m_listSourceId, m_listStart, m_listEnd);
+        return;
+    }
+    // taken now, the gaps will complete what is missing
+    m_cachedComponents = m_instanceCache->instances(m_listSourceId, m_listStart, m_listEnd, &m_cachedSpans);
+}
+
+bool FetchRequestData::nextGap()
+{
+    if (m_gaps.isEmpty()) {
+        return false;
+    }
+    m_currentGap = m_gaps.takeFirst();
+    return true;
+}
+
+time_t FetchRequestData::gapStart() const
+{
+    return m_currentGap.first;
+}
+
+time_t FetchRequestData::gapEnd() const
+{
+    return m_currentGap.second;
+}
+
+void FetchRequestData::storeGap()
+{
+    if (m_freeBusy) {
+        // the spans alone can not be cached
+        return;
+    }
+
+    if (m_useInstanceCache) {
+        m_instanceCache->insert(m_listSourceId,
+                                m_currentGap,
+                                m_currentComponents,
+                                m_currentSpans,
+                                m_gapsGeneration);
+    }
+    m_listedComponents = g_slist_concat(m_listedComponents, m_currentComponents);
+    m_listedSpans << m_currentSpans;
+    m_currentComponents = 0;
+    m_currentSpans.clear();
+}
+
+void FetchRequestData::mergeGaps()
+{
+    if (m_freeBusy) {
+        // duplicated spans disappear when the periods are merged
+        Q_FOREACH(const InstanceSpan &span, m_busySpans) {
+            if (InstanceCache::overlaps(span, m_listStart, m_listEnd)) {
+                m_busy[m_listSourceId] << span;
+            }
+        }
+        m_busySpans.clear();
+        return;
+    }
+
+    if (!m_useInstanceCache) {
+        m_currentComponents = m_listedComponents;
+        m_listedComponents = 0;
+        m_listedSpans.clear();
+        return;
+    }
+
+    // the buckets go beyond the requested range, and the instances
+    // overlapping several buckets were listed more than once
+    QSet<QByteArray> instances;
+    GSList *result = 0;
+    int index = 0;
+    for (GSList *l = m_listedComponents; l; l = l->next, index++) {
+        icalcomponent *comp = static_cast<icalcomponent*>(l->data);
+        const InstanceSpan &span = m_listedSpans.at(index);
+        QByteArray key = QByteArray(icalcomponent_get_uid(comp)) + '@' + QByteArray::number(qint64(span.first));
+        if (InstanceCache::overlaps(span, m_listStart, m_listEnd) && !instances.contains(key)) {
+            instances.insert(key);
+            result = g_slist_prepend(result, comp);
+        } else {
+            icalcomponent_free(comp);
+        }
+    }
+
+    index = 0;
+    for (GSList *l = m_cachedComponents; l; l = l->next, index++) {
+        icalcomponent *comp = static_cast<icalcomponent*>(l->data);
+        const InstanceSpan &span = m_cachedSpans.at(index);
+        QByteArray key = QByteArray(icalcomponent_get_uid(comp)) + '@' + QByteArray::number(qint64(span.first));
+        if (!instances.contains(key)) {
+            instances.insert(key);
+            result = g_slist_prepend(result, comp);
+        } else {
+            icalcomponent_free(comp);
+        }
+    }
+
+    g_slist_free(m_listedComponents);
+    m_listedComponents = 0;
+    m_listedSpans.clear();
+    g_slist_free(m_cachedComponents);
+    m_cachedComponents = 0;
+    m_cachedSpans.clear();
+
+    m_currentComponents = g_slist_reverse(result);
+}
+
+QByteArrayList FetchRequestData::filterSourceIds(const QByteArrayList &sourceIds,
+                                                 const QOrganizerItemFilter &filter)
 {
     QByteArrayList result;
-    if (filterIsValid()) {
-        QOrganizerItemFilter f = request<QOrganizerItemFetchRequest>()->filter();
-        QByteArrayList cFilters = sourceIdsFromFilter(f);
+    if (filter.type() != QOrganizerItemFilter::InvalidFilter) {
+        QByteArrayList cFilters = sourceIdsFromFilter(filter);
         if (cFilters.contains("*") || cFilters.isEmpty()) {
             result = sourceIds;
         } else {
@@ -283,7 +660,7 @@ QByteArrayList FetchRequestData::filterSourceIds(const QByteArrayList &sourceIds
     return result;
 }
 
-QByteArrayList FetchRequestData::sourceIdsFromFilter(const QOrganizerItemFilter &f) const
+QByteArrayList FetchRequestData::sourceIdsFromFilter(const QOrganizerItemFilter &f)
 {
     QByteArrayList result;
 
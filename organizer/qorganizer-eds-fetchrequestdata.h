@@ -20,6 +20,8 @@
 #define __QORGANIZER_EDS_FETCHREQUESTDATA_H__
 
 #include "qorganizer-eds-requestdata.h"
+#include "qorganizer-eds-requestscheduler.h"
+#include "qorganizer-eds-instancecache.h"
 #include <glib.h>
 
 class FetchRequestDataParseListener;
@@ -33,6 +35,8 @@ public:
     ~FetchRequestData();
 
     QByteArray nextSourceId();
+    bool allSourcesConnecting() const;
+    void setClientReadyConnection(const QMetaObject::Connection &connection);
     QByteArray nextParentId();
     QByteArray sourceId() const;
     time_t startDate() const;
@@ -40,15 +44,46 @@ public:
     bool hasDateInterval() const;
     bool filterIsValid() const;
     void cancel();
+    bool preempt();
     void compileCurrentIds();
+    RequestScheduler::Priority priority() const;
+    // only lists the instances, to have them cached for a later fetch
+    void setPrefetch(bool prefetch);
+    void setListing(bool listing);
+    bool isPreempted() const;
+    void rewindSource();
 
     void finish(QtOrganizer::QOrganizerManager::Error error = QtOrganizer::QOrganizerManager::NoError,
                 QtOrganizer::QOrganizerAbstractRequest::State state = QtOrganizer::QOrganizerAbstractRequest::FinishedState);
-    void appendResult(icalcomponent *comp);
+    void appendInstance(icalcomponent *comp, time_t start, time_t end);
+    // with EDS_FREE_BUSY_PARAMETER, a fetch asking only for the event times
+    // gets the busy periods of each collection instead of the items
+    bool isFreeBusy() const;
+    void appendBusySpan(time_t start, time_t end);
+    void appendResults(GSList *comps);
     void appendDeatachedResult(icalcomponent *comp);
     int appendResults(QList<QtOrganizer::QOrganizerItem> results);
     QString dateFilter();
 
+    // the current source is listed on the I/O thread, these do not touch
+    // the request
+    bool listInterval() const;
+    time_t listStart() const;
+    time_t listEnd() const;
+    QByteArray listQuery() const;
+    void setListError(QtOrganizer::QOrganizerManager::Error error);
+    QtOrganizer::QOrganizerManager::Error listError() const;
+    // only the ranges not in the instance cache are listed
+    void planGaps();
+    bool nextGap();
+    time_t gapStart() const;
+    time_t gapEnd() const;
+    void storeGap();
+    void mergeGaps();
+
+    static QByteArrayList filterSourceIds(const QByteArrayList &sourceIds,
+                                          const QtOrganizer::QOrganizerItemFilter &filter);
+
 private:
     FetchRequestDataParseListener *m_parseListener;
     QMap<QByteArray, GSList*> m_components;
@@ -58,9 +93,33 @@ private:
     QByteArray m_current;
     GSList* m_currentComponents;
     QList<QtOrganizer::QOrganizerItem> m_results;
+    QMetaObject::Connection m_clientReadyConnection;
+    bool m_listInterval;
+    time_t m_listStart;
+    time_t m_listEnd;
+    QByteArray m_listQuery;
+    QtOrganizer::QOrganizerManager::Error m_listError;
+    bool m_listing;
+    bool m_preempted;
+    bool m_prefetch;
+    bool m_freeBusy;
+    QList<InstanceSpan> m_busySpans;
+    QMap<QByteArray, QList<InstanceSpan> > m_busy;
+    bool m_useInstanceCache;
+    // taken on the engine thread, the I/O thread must not go through the engine
+    InstanceCache *m_instanceCache;
+    QByteArray m_listSourceId;
+    uint m_gapsGeneration;
+    QList<InstanceSpan> m_gaps;
+    InstanceSpan m_currentGap;
+    QList<InstanceSpan> m_currentSpans;
+    GSList *m_listedComponents;
+    QList<InstanceSpan> m_listedSpans;
+    GSList *m_cachedComponents;
+    QList<InstanceSpan> m_cachedSpans;
 
-    QByteArrayList filterSourceIds(const QByteArrayList &collections) const;
-    QByteArrayList sourceIdsFromFilter(const QtOrganizer::QOrganizerItemFilter &f) const;
+    static QByteArrayList sourceIdsFromFilter(const QtOrganizer::QOrganizerItemFilter &f);
+    void appendBusyPeriods();
     void finishContinue(QtOrganizer::QOrganizerManager::Error error,
                         QtOrganizer::QOrganizerAbstractRequest::State state);
 
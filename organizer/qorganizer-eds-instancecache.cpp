@@ -0,0 +1,299 @@
+/*
+ * Copyright 2015 Canonical Ltd.
+ *
+ * This file is part of canonical-pim-service.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "qorganizer-eds-instancecache.h"
+
+#include <QtCore/QMutexLocker>
+
+#include <libecal/libecal.h>
+
+// Size of the cached buckets, in seconds
+#define INSTANCE_CACHE_BUCKET       (24 * 60 * 60)
+// A collection with more cached instances than this starts over
+#define INSTANCE_CACHE_SIZE         20000
+// Beyond this many instances in total the biggest collections start over
+#define INSTANCE_CACHE_TOTAL_SIZE   50000
+
+InstanceCache::InstanceCache()
+    : m_size(0)
+{
+}
+
+InstanceCache::~InstanceCache()
+{
+    QMutexLocker locker(&m_mutex);
+    for (QHash<QByteArray, Source>::iterator i = m_sources.begin(); i != m_sources.end(); ++i) {
+        reset(i.value());
+    }
+}
+
+QList<InstanceSpan> InstanceCache::gaps(const QByteArray &sourceId,
+                                        time_t start,
+                                        time_t end,
+                                        uint *generation)
+{
+    QMutexLocker locker(&m_mutex);
+    Source &source = m_sources[sourceId];
+    *generation = source.generation;
+
+    QList<InstanceSpan> result;
+    qint64 last = bucket(qMax(start, end - 1));
+    for (qint64 b = bucket(start); b <= last; b++) {
+        if (source.buckets.contains(b)) {
+            continue;
+        }
+        time_t bucketStart = b * INSTANCE_CACHE_BUCKET;
+        if (!result.isEmpty() && (result.last().second == bucketStart)) {
+            result.last().second += INSTANCE_CACHE_BUCKET;
+        } else {
+            result << InstanceSpan(bucketStart, bucketStart + INSTANCE_CACHE_BUCKET);
+        }
+    }
+    return result;
+}
+
+bool InstanceCache::covers(const QByteArray &sourceId, time_t start, time_t end)
+{
+    uint generation;
+    return gaps(sourceId, start, end, &generation).isEmpty();
+}
+
+GSList *InstanceCache::instances(const QByteArray &sourceId,
+                                 time_t start,
+                                 time_t end,
+                                 QList<InstanceSpan> *spans)
+{
+    QMutexLocker locker(&m_mutex);
+    QHash<QByteArray, Source>::const_iterator s = m_sources.constFind(sourceId);
+    if (s == m_sources.constEnd()) {
+        return 0;
+    }
+
+    GSList *result = 0;
+    typedef IntervalIndex<Instance>::Entry Entry;
+    QList<Entry> entries = s.value().instances.overlapping(start, end);
+    for (int i = entries.size() - 1; i >= 0; i--) {
+        const Entry &entry = entries.at(i);
+        result = g_slist_prepend(result, icalcomponent_new_clone(entry.value.component));
+        spans->prepend(InstanceSpan(entry.start, entry.end));
+    }
+    return result;
+}
+
+QList<InstanceSpan> InstanceCache::busySpans(const QByteArray &sourceId, time_t start, time_t end)
+{
+    QMutexLocker locker(&m_mutex);
+    QList<InstanceSpan> result;
+    QHash<QByteArray, Source>::const_iterator s = m_sources.constFind(sourceId);
+    if (s == m_sources.constEnd()) {
+        return result;
+    }
+
+    Q_FOREACH(const IntervalIndex<Instance>::Entry &entry, s.value().instances.overlapping(start, end)) {
+        if (isBusy(entry.value.component)) {
+            result << InstanceSpan(entry.start, entry.end);
+        }
+    }
+    return result;
+}
+
+void InstanceCache::insert(const QByteArray &sourceId,
+                           const InstanceSpan &gap,
+                           GSList *components,
+                           const QList<InstanceSpan> &spans,
+                           uint generation)
+{
+    QMutexLocker locker(&m_mutex);
+    Source &source = m_sources[sourceId];
+    if (source.generation != generation) {
+        return;
+    }
+
+    QVector<IntervalIndex<Instance>::Entry> entries;
+    QSet<QByteArray> added;
+    int index = 0;
+    for (GSList *l = components; l; l = l->next, index++) {
+        icalcomponent *comp = static_cast<icalcomponent*>(l->data);
+        const InstanceSpan &span = spans.at(index);
+        QByteArray uid(icalcomponent_get_uid(comp));
+
+        // instances overlapping other buckets may be there already
+        bool known = source.instances.containsAt(span.first,
+                                                 [&uid](const IntervalIndex<Instance>::Entry &entry) {
+            return entry.value.uid == uid;
+        });
+        QByteArray key = uid + '@' + QByteArray::number(qint64(span.first));
+        if (known || added.contains(key)) {
+            continue;
+        }
+        added.insert(key);
+
+        IntervalIndex<Instance>::Entry entry;
+        entry.start = span.first;
+        entry.end = span.second;
+        entry.value.uid = uid;
+        entry.value.component = icalcomponent_new_clone(comp);
+        entries << entry;
+    }
+    source.instances.insert(entries);
+    m_size += entries.size();
+
+    for (qint64 b = bucket(gap.first); b < bucket(gap.second); b++) {
+        source.buckets.insert(b);
+    }
+
+    if (source.instances.size() > INSTANCE_CACHE_SIZE) {
+        reset(source);
+    }
+    shrink(sourceId);
+}
+
+void InstanceCache::invalidate(const QByteArray &sourceId, icalcomponent *comp)
+{
+    QMutexLocker locker(&m_mutex);
+    QHash<QByteArray, Source>::iterator s = m_sources.find(sourceId);
+    if (s == m_sources.end()) {
+        return;
+    }
+
+    Source &source = s.value();
+    removeUid(source, QByteArray(icalcomponent_get_uid(comp)));
+
+    // the new instances may be anywhere
+    struct icaltimetype dtStart = icalcomponent_get_dtstart(comp);
+    if (icaltime_is_null_time(dtStart) || e_cal_util_component_has_recurrences(comp)) {
+        reset(source);
+        return;
+    }
+
+    struct icaltimetype dtEnd = icalcomponent_get_dtend(comp);
+    if (icaltime_is_null_time(dtEnd)) {
+        dtEnd = dtStart;
+    }
+
+    // the time zone may not be known here, a bucket on each side covers
+    // any offset
+    icaltimezone *utc = icaltimezone_get_utc_timezone();
+    time_t start = icaltime_as_timet_with_zone(dtStart, dtStart.zone ? dtStart.zone : utc);
+    time_t end = icaltime_as_timet_with_zone(dtEnd, dtEnd.zone ? dtEnd.zone : utc);
+    uncover(source,
+            start - INSTANCE_CACHE_BUCKET,
+            qMax(start, end) + INSTANCE_CACHE_BUCKET);
+}
+
+void InstanceCache::invalidate(const QByteArray &sourceId, const QByteArray &uid)
+{
+    QMutexLocker locker(&m_mutex);
+    QHash<QByteArray, Source>::iterator s = m_sources.find(sourceId);
+    if (s != m_sources.end()) {
+        removeUid(s.value(), uid);
+    }
+}
+
+void InstanceCache::clear(const QByteArray &sourceId)
+{
+    QMutexLocker locker(&m_mutex);
+    QHash<QByteArray, Source>::iterator s = m_sources.find(sourceId);
+    if (s != m_sources.end()) {
+        reset(s.value());
+    }
+}
+
+bool InstanceCache::overlaps(const InstanceSpan &span, time_t start, time_t end)
+{
+    return IntervalIndex<Instance>::overlaps(span.first, span.second, start, end);
+}
+
+bool InstanceCache::isBusy(icalcomponent *comp)
+{
+    // tasks have a due date, they do not take the time
+    if (icalcomponent_isa(comp) != ICAL_VEVENT_COMPONENT) {
+        return false;
+    }
+    if (icalcomponent_get_status(comp) == ICAL_STATUS_CANCELLED) {
+        return false;
+    }
+    icalproperty *transp = icalcomponent_get_first_property(comp, ICAL_TRANSP_PROPERTY);
+    return !transp || (icalproperty_get_transp(transp) != ICAL_TRANSP_TRANSPARENT);
+}
+
+void InstanceCache::removeUid(Source &source, const QByteArray &uid)
+{
+    QList<InstanceSpan> removed;
+    m_size -= source.instances.removeIf([&uid, &removed](const IntervalIndex<Instance>::Entry &entry) {
+        if (entry.value.uid != uid) {
+            return false;
+        }
+        removed << InstanceSpan(entry.start, entry.end);
+        icalcomponent_free(entry.value.component);
+        return true;
+    });
+
+    // the buckets of the instances may now miss a detached instance
+    Q_FOREACH(const InstanceSpan &span, removed) {
+        uncover(source, span.first, qMax(span.first + 1, span.second));
+    }
+    source.generation++;
+}
+
+void InstanceCache::uncover(Source &source, time_t start, time_t end)
+{
+    qint64 last = bucket(qMax(start, end - 1));
+    for (qint64 b = bucket(start); b <= last; b++) {
+        source.buckets.remove(b);
+    }
+    source.generation++;
+}
+
+void InstanceCache::reset(Source &source)
+{
+    Q_FOREACH(const IntervalIndex<Instance>::Entry &entry, source.instances.entries()) {
+        icalcomponent_free(entry.value.component);
+    }
+    m_size -= source.instances.size();
+    source.instances.clear();
+    source.buckets.clear();
+    source.generation++;
+}
+
+void InstanceCache::shrink(const QByteArray &sourceId)
+{
+    // the collection just filled is the one in use, it goes last
+    while (m_size > INSTANCE_CACHE_TOTAL_SIZE) {
+        QHash<QByteArray, Source>::iterator biggest = m_sources.end();
+        for (QHash<QByteArray, Source>::iterator i = m_sources.begin(); i != m_sources.end(); ++i) {
+            if ((i.key() != sourceId) && !i.value().instances.isEmpty() &&
+                ((biggest == m_sources.end()) ||
+                 (i.value().instances.size() > biggest.value().instances.size()))) {
+                biggest = i;
+            }
+        }
+        if (biggest == m_sources.end()) {
+            biggest = m_sources.find(sourceId);
+        }
+        reset(biggest.value());
+    }
+}
+
+qint64 InstanceCache::bucket(time_t time)
+{
+    // round towards the past for times before the epoch too
+    qint64 t = time;
+    return (t >= 0) ? (t / INSTANCE_CACHE_BUCKET)
+                    : -((-t + INSTANCE_CACHE_BUCKET - 1) / INSTANCE_CACHE_BUCKET);
+}
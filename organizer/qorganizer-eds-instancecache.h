@@ -0,0 +1,101 @@
+/*
+ * Copyright 2015 Canonical Ltd.
+ *
+ * This file is part of canonical-pim-service.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __QORGANIZER_EDS_INSTANCECACHE_H__
+#define __QORGANIZER_EDS_INSTANCECACHE_H__
+
+#include "qorganizer-eds-intervalindex.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QPair>
+#include <QtCore/QSet>
+
+#include <glib.h>
+#include <libical/ical.h>
+
+// start and end of an expanded instance
+typedef QPair<time_t, time_t> InstanceSpan;
+
+// Recurrence instances already expanded for each collection, split in day
+// long buckets. A bucket is covered once every instance overlapping it was
+// listed, so a new range only needs the buckets not covered yet. The
+// watchers drop the instances of changed items and uncover their buckets.
+// Used from the I/O thread and the main thread.
+class InstanceCache
+{
+public:
+    InstanceCache();
+    ~InstanceCache();
+
+    // ranges of [start, end) not covered yet, bucket aligned
+    QList<InstanceSpan> gaps(const QByteArray &sourceId,
+                             time_t start,
+                             time_t end,
+                             uint *generation);
+    bool covers(const QByteArray &sourceId, time_t start, time_t end);
+    // copies of the cached instances overlapping [start, end)
+    GSList *instances(const QByteArray &sourceId,
+                      time_t start,
+                      time_t end,
+                      QList<InstanceSpan> *spans);
+    // spans of the cached instances overlapping [start, end) which take
+    // time in the calendar
+    QList<InstanceSpan> busySpans(const QByteArray &sourceId, time_t start, time_t end);
+    // stores the instances listed for a gap, unless something changed since
+    // the gaps were computed
+    void insert(const QByteArray &sourceId,
+                const InstanceSpan &gap,
+                GSList *components,
+                const QList<InstanceSpan> &spans,
+                uint generation);
+
+    void invalidate(const QByteArray &sourceId, icalcomponent *comp);
+    void invalidate(const QByteArray &sourceId, const QByteArray &uid);
+    void clear(const QByteArray &sourceId);
+
+    static bool overlaps(const InstanceSpan &span, time_t start, time_t end);
+    static bool isBusy(icalcomponent *comp);
+
+private:
+    struct Instance {
+        QByteArray uid;
+        icalcomponent *component;
+    };
+
+    struct Source {
+        Source() : generation(0) {}
+        IntervalIndex<Instance> instances;
+        QSet<qint64> buckets;
+        uint generation;
+    };
+
+    QMutex m_mutex;
+    QHash<QByteArray, Source> m_sources;
+    int m_size;
+
+    void removeUid(Source &source, const QByteArray &uid);
+    void uncover(Source &source, time_t start, time_t end);
+    void reset(Source &source);
+    void shrink(const QByteArray &sourceId);
+    static qint64 bucket(time_t time);
+};
+
+#endif
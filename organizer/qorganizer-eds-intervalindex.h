@@ -0,0 +1,225 @@
+/*
+ * Copyright 2015 Canonical Ltd.
+ *
+ * This file is part of canonical-pim-service.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __QORGANIZER_EDS_INTERVALINDEX_H__
+#define __QORGANIZER_EDS_INTERVALINDEX_H__
+
+#include <QtCore/QList>
+#include <QtCore/QVector>
+
+#include <algorithm>
+
+#include <time.h>
+
+// Values indexed by a [start, end) time span, answering which of them
+// overlap a range with two binary searches plus the matches. Entries are
+// kept sorted by start next to the running maximum of their ends; entries
+// with start == end are points and match ranges containing them.
+template<class T>
+class IntervalIndex
+{
+public:
+    struct Entry {
+        time_t start;
+        time_t end;
+        T value;
+    };
+
+    IntervalIndex()
+        : m_dirtyFrom(0)
+    {
+    }
+
+    int size() const
+    {
+        return m_entries.size();
+    }
+
+    bool isEmpty() const
+    {
+        return m_entries.isEmpty();
+    }
+
+    const QVector<Entry> &entries() const
+    {
+        return m_entries;
+    }
+
+    void clear()
+    {
+        m_entries.clear();
+        m_maxEnd.clear();
+        m_dirtyFrom = 0;
+    }
+
+    void insert(time_t start, time_t end, const T &value)
+    {
+        Entry entry;
+        entry.start = start;
+        entry.end = end;
+        entry.value = value;
+
+        // after the entries with the same start
+        int index = lowerBound(start + 1);
+        m_entries.insert(index, entry);
+        m_dirtyFrom = qMin(m_dirtyFrom, index);
+    }
+
+    // adds many entries at once, merged in instead of moving the tail for
+    // each of them
+    void insert(QVector<Entry> entries)
+    {
+        if (entries.isEmpty()) {
+            return;
+        }
+
+        // stable, the new entries go after those with the same start
+        std::stable_sort(entries.begin(), entries.end(), startsBefore);
+        int index = lowerBound(entries.first().start + 1);
+        int middle = m_entries.size();
+        m_entries += entries;
+        std::inplace_merge(m_entries.begin() + index,
+                           m_entries.begin() + middle,
+                           m_entries.end(),
+                           startsBefore);
+        m_dirtyFrom = qMin(m_dirtyFrom, index);
+    }
+
+    // removes the entries the predicate accepts, it gets each Entry
+    template<class P>
+    int removeIf(P predicate)
+    {
+        int next = 0;
+        int firstRemoved = -1;
+        for (int i = 0; i < m_entries.size(); i++) {
+            if (predicate(m_entries.at(i))) {
+                if (firstRemoved < 0) {
+                    firstRemoved = i;
+                }
+                continue;
+            }
+            if (next != i) {
+                m_entries[next] = m_entries.at(i);
+            }
+            next++;
+        }
+
+        int removed = m_entries.size() - next;
+        if (removed) {
+            m_entries.resize(next);
+            m_dirtyFrom = qMin(m_dirtyFrom, firstRemoved);
+        }
+        return removed;
+    }
+
+    // checks the entries starting exactly at start
+    template<class P>
+    bool containsAt(time_t start, P predicate) const
+    {
+        for (int i = lowerBound(start); (i < m_entries.size()) && (m_entries.at(i).start == start); i++) {
+            if (predicate(m_entries.at(i))) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    QList<Entry> overlapping(time_t start, time_t end) const
+    {
+        QList<Entry> result;
+        updateMaxEnd();
+
+        // nothing before first ends after start, nothing from last on
+        // starts before end
+        int first = firstEndingAfter(start);
+        int last = lowerBound(end);
+        for (int i = first; i < last; i++) {
+            const Entry &entry = m_entries.at(i);
+            if (overlaps(entry.start, entry.end, start, end)) {
+                result << entry;
+            }
+        }
+        return result;
+    }
+
+    static bool overlaps(time_t entryStart, time_t entryEnd, time_t start, time_t end)
+    {
+        if (entryStart == entryEnd) {
+            return (entryStart >= start) && (entryStart < end);
+        }
+        return (entryStart < end) && (entryEnd > start);
+    }
+
+private:
+    QVector<Entry> m_entries;
+    mutable QVector<time_t> m_maxEnd;
+    mutable int m_dirtyFrom;
+
+    static bool startsBefore(const Entry &a, const Entry &b)
+    {
+        return a.start < b.start;
+    }
+
+    // first entry starting at or after time
+    int lowerBound(time_t time) const
+    {
+        int low = 0;
+        int high = m_entries.size();
+        while (low < high) {
+            int middle = (low + high) / 2;
+            if (m_entries.at(middle).start < time) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        return low;
+    }
+
+    // first entry whose running maximum end reaches time, points at time
+    // included
+    int firstEndingAfter(time_t time) const
+    {
+        int low = 0;
+        int high = m_maxEnd.size();
+        while (low < high) {
+            int middle = (low + high) / 2;
+            if (m_maxEnd.at(middle) < time) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        return low;
+    }
+
+    void updateMaxEnd() const
+    {
+        if (m_dirtyFrom >= m_entries.size() && m_maxEnd.size() == m_entries.size()) {
+            return;
+        }
+        m_maxEnd.resize(m_entries.size());
+        for (int i = m_dirtyFrom; i < m_entries.size(); i++) {
+            time_t end = m_entries.at(i).end;
+            m_maxEnd[i] = (i > 0) ? qMax(m_maxEnd.at(i - 1), end) : end;
+        }
+        m_dirtyFrom = m_entries.size();
+    }
+};
+
+#endif
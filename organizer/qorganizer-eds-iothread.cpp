@@ -0,0 +1,71 @@
+/*
+ * Copyright 2015 Canonical Ltd.
+ *
+ * This file is part of canonical-pim-service.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "qorganizer-eds-iothread.h"
+
+QOrganizerEDSIOThread::QOrganizerEDSIOThread(QObject *parent)
+    : QThread(parent)
+{
+    m_context = g_main_context_new();
+    m_loop = g_main_loop_new(m_context, FALSE);
+    start();
+}
+
+QOrganizerEDSIOThread::~QOrganizerEDSIOThread()
+{
+    // queued, the loop could not be running yet
+    invoke((GSourceFunc) QOrganizerEDSIOThread::quit, m_loop);
+    wait();
+
+    g_main_loop_unref(m_loop);
+    g_main_context_unref(m_context);
+}
+
+GMainContext *QOrganizerEDSIOThread::context() const
+{
+    return m_context;
+}
+
+void QOrganizerEDSIOThread::invoke(GSourceFunc func, gpointer data)
+{
+    invoke(m_context, func, data);
+}
+
+void QOrganizerEDSIOThread::invoke(GMainContext *context, GSourceFunc func, gpointer data)
+{
+    // g_main_context_invoke() would run the function on the calling thread
+    // if the context is not owned yet
+    GSource *source = g_idle_source_new();
+    g_source_set_priority(source, G_PRIORITY_DEFAULT);
+    g_source_set_callback(source, func, data, NULL);
+    g_source_attach(source, context);
+    g_source_unref(source);
+}
+
+gboolean QOrganizerEDSIOThread::quit(GMainLoop *loop)
+{
+    g_main_loop_quit(loop);
+    return FALSE;
+}
+
+void QOrganizerEDSIOThread::run()
+{
+    g_main_context_push_thread_default(m_context);
+    g_main_loop_run(m_loop);
+    g_main_context_pop_thread_default(m_context);
+}
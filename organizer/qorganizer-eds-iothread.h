@@ -0,0 +1,50 @@
+/*
+ * Copyright 2015 Canonical Ltd.
+ *
+ * This file is part of canonical-pim-service.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __QORGANIZER_EDS_IOTHREAD_H__
+#define __QORGANIZER_EDS_IOTHREAD_H__
+
+#include <QThread>
+
+#include <glib.h>
+
+// Thread running its own GMainContext. EDS calls issued from functions
+// invoked here report back on this thread instead of the main loop.
+class QOrganizerEDSIOThread : public QThread
+{
+public:
+    QOrganizerEDSIOThread(QObject *parent = 0);
+    ~QOrganizerEDSIOThread();
+
+    GMainContext *context() const;
+    void invoke(GSourceFunc func, gpointer data);
+
+    // queue the call on the given context, it will run on its thread
+    static void invoke(GMainContext *context, GSourceFunc func, gpointer data);
+
+private:
+    GMainContext *m_context;
+    GMainLoop *m_loop;
+
+    static gboolean quit(GMainLoop *loop);
+
+    // virtual
+    void run();
+};
+
+#endif
@@ -0,0 +1,63 @@
+/*
+ * Copyright 2015 Canonical Ltd.
+ *
+ * This file is part of canonical-pim-service.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "qorganizer-eds-itemidpool.h"
+
+#include <QtCore/QReadLocker>
+#include <QtCore/QVarLengthArray>
+#include <QtCore/QWriteLocker>
+
+#include <string.h>
+
+// max number of interned ids, the pool starts over once it is full
+#define ITEM_ID_POOL_SIZE   100000
+
+QReadWriteLock ItemIdPool::m_lock;
+QSet<QByteArray> ItemIdPool::m_ids;
+
+QByteArray ItemIdPool::localId(const QByteArray &sourceId, const QByteArray &uid)
+{
+    // compose the id on the stack, only a miss copies it to the heap
+    QVarLengthArray<char, 256> buffer(sourceId.size() + 1 + uid.size());
+    memcpy(buffer.data(), sourceId.constData(), sourceId.size());
+    buffer[sourceId.size()] = '/';
+    memcpy(buffer.data() + sourceId.size() + 1, uid.constData(), uid.size());
+    const QByteArray key = QByteArray::fromRawData(buffer.constData(), buffer.size());
+
+    {
+        QReadLocker locker(&m_lock);
+        QSet<QByteArray>::const_iterator i = m_ids.constFind(key);
+        if (i != m_ids.constEnd()) {
+            return *i;
+        }
+    }
+
+    QByteArray id(buffer.constData(), buffer.size());
+    QWriteLocker locker(&m_lock);
+    if (m_ids.size() >= ITEM_ID_POOL_SIZE) {
+        m_ids.clear();
+    }
+    m_ids.insert(id);
+    return id;
+}
+
+void ItemIdPool::clear()
+{
+    QWriteLocker locker(&m_lock);
+    m_ids.clear();
+}
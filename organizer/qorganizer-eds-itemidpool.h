@@ -0,0 +1,41 @@
+/*
+ * Copyright 2015 Canonical Ltd.
+ *
+ * This file is part of canonical-pim-service.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __QORGANIZER_EDS_ITEMIDPOOL_H__
+#define __QORGANIZER_EDS_ITEMIDPOOL_H__
+
+#include <QtCore/QByteArray>
+#include <QtCore/QReadWriteLock>
+#include <QtCore/QSet>
+
+// Interned item local ids ("<source id>/<uid>"). The same item is parsed
+// again on every fetch and watcher change; with the pool all the copies
+// handed to the models share a single buffer, and a hit does not build a
+// new one.
+class ItemIdPool
+{
+public:
+    static QByteArray localId(const QByteArray &sourceId, const QByteArray &uid);
+    static void clear();
+
+private:
+    static QReadWriteLock m_lock;
+    static QSet<QByteArray> m_ids;
+};
+
+#endif
@@ -38,19 +38,24 @@ void QOrganizerParseEventThread::start(QMap<QOrganizerCollectionId, GSList *> ev
 {
     m_events = events;
     m_isIcalEvents = isIcalEvents;
-    m_detailsHint = detailsHint;
+    m_plan = ParsePlan(detailsHint);
     QThread::start();
 }
 
 void QOrganizerParseEventThread::run()
 {
     QList<QOrganizerItem> result;
+    int size = 0;
+    Q_FOREACH(GSList *components, m_events) {
+        size += g_slist_length(components);
+    }
+    result.reserve(size);
 
     Q_FOREACH(const QOrganizerCollectionId &id, m_events.keys()) {
         if (!m_source) {
             break;
         }
-        result += QOrganizerEDSEngine::parseEvents(id, m_events.value(id), m_isIcalEvents, m_detailsHint);
+        result += QOrganizerEDSEngine::parseEvents(id, m_events.value(id), m_isIcalEvents, m_plan);
     }
 
     if (m_source && m_slot.isValid()) {
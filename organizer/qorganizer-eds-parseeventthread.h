@@ -32,6 +32,8 @@
 
 #include <glib.h>
 
+#include "qorganizer-eds-parseplan.h"
+
 class QOrganizerParseEventThread : public QThread
 {
     Q_OBJECT
@@ -53,7 +55,7 @@ private:
     // parse data
     QMap<QtOrganizer::QOrganizerCollectionId, GSList *> m_events;
     bool m_isIcalEvents;
-    QList<QtOrganizer::QOrganizerItemDetail::DetailType> m_detailsHint;
+    ParsePlan m_plan;
 
     // virtual
     void run();
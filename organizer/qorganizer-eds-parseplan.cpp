@@ -0,0 +1,208 @@
+/*
+ * Copyright 2015 Canonical Ltd.
+ *
+ * This file is part of canonical-pim-service.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "qorganizer-eds-parseplan.h"
+#include "qorganizer-eds-engine.h"
+
+#include <QtCore/QDebug>
+
+#include <QtOrganizer/QOrganizerItemType>
+
+using namespace QtOrganizer;
+
+ParsePlan::ParsePlan(const QList<QOrganizerItemDetail::DetailType> &detailsHint)
+    : m_detailsHint(detailsHint),
+      m_eventHandlers(ICAL_NO_PROPERTY + 1, 0),
+      m_todoHandlers(ICAL_NO_PROPERTY + 1, 0),
+      m_journalHandlers(ICAL_NO_PROPERTY + 1, 0)
+{
+    // events
+    if (wants(QOrganizerItemDetail::TypeEventTime)) {
+        addHandler(&m_eventHandlers, ICAL_DTSTART_PROPERTY, &QOrganizerEDSEngine::parseStartTime);
+        addHandler(&m_eventHandlers, ICAL_DTEND_PROPERTY, &QOrganizerEDSEngine::parseEndTime);
+    }
+    if (wants(QOrganizerItemDetail::TypeLocation)) {
+        addHandler(&m_eventHandlers, ICAL_LOCATION_PROPERTY, &QOrganizerEDSEngine::parseLocation);
+    }
+
+    // todos
+    if (wants(QOrganizerItemDetail::TypeTodoTime)) {
+        addHandler(&m_todoHandlers, ICAL_DTSTART_PROPERTY, &QOrganizerEDSEngine::parseTodoStartTime);
+        addHandler(&m_todoHandlers, ICAL_DUE_PROPERTY, &QOrganizerEDSEngine::parseDueDate);
+    }
+    if (wants(QOrganizerItemDetail::TypeTodoProgress)) {
+        addHandler(&m_todoHandlers, ICAL_PERCENTCOMPLETE_PROPERTY, &QOrganizerEDSEngine::parseProgress);
+    }
+
+    // events and todos
+    QList<QVector<Handler>*> recurrent;
+    recurrent << &m_eventHandlers << &m_todoHandlers;
+    Q_FOREACH(QVector<Handler> *handlers, recurrent) {
+        if (wants(QOrganizerItemDetail::TypeRecurrence)) {
+            addHandler(handlers, ICAL_RDATE_PROPERTY, &QOrganizerEDSEngine::parseRecurrenceDate);
+            addHandler(handlers, ICAL_EXDATE_PROPERTY, &QOrganizerEDSEngine::parseExceptionDate);
+            addHandler(handlers, ICAL_RRULE_PROPERTY, &QOrganizerEDSEngine::parseRecurrenceRule);
+        }
+        if (wants(QOrganizerItemDetail::TypePriority)) {
+            addHandler(handlers, ICAL_PRIORITY_PROPERTY, &QOrganizerEDSEngine::parsePriority);
+        }
+    }
+
+    // journals
+    if (wants(QOrganizerItemDetail::TypeJournalTime)) {
+        addHandler(&m_journalHandlers, ICAL_DTSTART_PROPERTY, &QOrganizerEDSEngine::parseJournalTime);
+    }
+
+    // all kinds
+    QList<QVector<Handler>*> all(recurrent);
+    all << &m_journalHandlers;
+    Q_FOREACH(QVector<Handler> *handlers, all) {
+        if (wants(QOrganizerItemDetail::TypeDescription)) {
+            addHandler(handlers, ICAL_DESCRIPTION_PROPERTY, &QOrganizerEDSEngine::parseDescription);
+        }
+        if (wants(QOrganizerItemDetail::TypeDisplayLabel)) {
+            addHandler(handlers, ICAL_SUMMARY_PROPERTY, &QOrganizerEDSEngine::parseSummary);
+        }
+        if (wants(QOrganizerItemDetail::TypeComment)) {
+            addHandler(handlers, ICAL_COMMENT_PROPERTY, &QOrganizerEDSEngine::parseComment);
+        }
+        if (wants(QOrganizerItemDetail::TypeTag)) {
+            addHandler(handlers, ICAL_CATEGORIES_PROPERTY, &QOrganizerEDSEngine::parseTags);
+        }
+        if (wants(QOrganizerItemDetail::TypeEventAttendee)) {
+            addHandler(handlers, ICAL_ATTENDEE_PROPERTY, &QOrganizerEDSEngine::parseAttendee);
+        }
+        if (wants(QOrganizerItemDetail::TypeExtendedDetail)) {
+            addHandler(handlers, ICAL_X_PROPERTY, &QOrganizerEDSEngine::parseExtendedDetail);
+        }
+    }
+
+    m_description = wants(QOrganizerItemDetail::TypeDescription);
+    m_todoStatus = wants(QOrganizerItemDetail::TypeTodoProgress);
+    m_reminders = wants(QOrganizerItemDetail::TypeReminder) ||
+                  wants(QOrganizerItemDetail::TypeVisualReminder) ||
+                  wants(QOrganizerItemDetail::TypeAudibleReminder) ||
+                  wants(QOrganizerItemDetail::TypeEmailReminder);
+}
+
+QList<QOrganizerItemDetail::DetailType> ParsePlan::detailsHint() const
+{
+    return m_detailsHint;
+}
+
+bool ParsePlan::parse(icalcomponent *ical,
+                      const QOrganizerCollectionId &collectionId,
+                      QOrganizerItem *item) const
+{
+    const QVector<Handler> *handlers;
+    QOrganizerItemType::ItemType type;
+    QOrganizerItemType::ItemType occurrenceType;
+
+    switch(icalcomponent_isa(ical)) {
+    case ICAL_VEVENT_COMPONENT:
+        handlers = &m_eventHandlers;
+        type = QOrganizerItemType::TypeEvent;
+        occurrenceType = QOrganizerItemType::TypeEventOccurrence;
+        break;
+    case ICAL_VTODO_COMPONENT:
+        handlers = &m_todoHandlers;
+        type = QOrganizerItemType::TypeTodo;
+        occurrenceType = QOrganizerItemType::TypeTodoOccurrence;
+        break;
+    case ICAL_VJOURNAL_COMPONENT:
+        handlers = &m_journalHandlers;
+        type = QOrganizerItemType::TypeJournal;
+        occurrenceType = QOrganizerItemType::TypeJournal;
+        break;
+    case ICAL_VFREEBUSY_COMPONENT:
+        qWarning() << "Component FREEBUSY not supported;";
+        return false;
+    case ICAL_VTIMEZONE_COMPONENT:
+        qWarning() << "Component TIMEZONE not supported;";
+        return false;
+    default:
+        return false;
+    }
+
+    item->setType(type);
+
+    icalproperty *uid = 0;
+    icalproperty *rid = 0;
+    icalproperty *status = 0;
+    for (icalproperty *prop = icalcomponent_get_first_property(ical, ICAL_ANY_PROPERTY);
+         prop != 0;
+         prop = icalcomponent_get_next_property(ical, ICAL_ANY_PROPERTY)) {
+        icalproperty_kind kind = icalproperty_isa(prop);
+        switch (kind) {
+        case ICAL_UID_PROPERTY:
+            uid = uid ? uid : prop;
+            break;
+        case ICAL_RECURRENCEID_PROPERTY:
+            rid = rid ? rid : prop;
+            break;
+        case ICAL_STATUS_PROPERTY:
+            status = status ? status : prop;
+            break;
+        default:
+            break;
+        }
+
+        Handler handler = handlers->value(kind, 0);
+        if (handler) {
+            handler(prop, item);
+        }
+    }
+
+    QByteArray rId = rid ? QOrganizerEDSEngine::recurrenceId(rid) : QByteArray();
+    if (!rId.isEmpty() && (rId != "0")) {
+        item->setType(occurrenceType);
+    }
+
+    // id is mandatory
+    QOrganizerEDSEngine::parseId(QByteArray(uid ? icalproperty_get_uid(uid) : 0),
+                                 rId, item, collectionId);
+
+    if (m_description && item->detail(QOrganizerItemDetail::TypeDescription).isEmpty()) {
+        item->setDescription(QString());
+    }
+
+    if (m_todoStatus && (handlers == &m_todoHandlers)) {
+        QOrganizerEDSEngine::parseStatus(status ? icalproperty_get_status(status) : ICAL_STATUS_NONE,
+                                         item);
+    }
+
+    if (m_reminders) {
+        for (icalcomponent *alarm = icalcomponent_get_first_component(ical, ICAL_VALARM_COMPONENT);
+             alarm != 0;
+             alarm = icalcomponent_get_next_component(ical, ICAL_VALARM_COMPONENT)) {
+            QOrganizerEDSEngine::parseReminder(alarm, item, m_detailsHint);
+        }
+    }
+
+    return true;
+}
+
+bool ParsePlan::wants(QOrganizerItemDetail::DetailType type) const
+{
+    return m_detailsHint.isEmpty() || m_detailsHint.contains(type);
+}
+
+void ParsePlan::addHandler(QVector<Handler> *handlers, icalproperty_kind kind, Handler handler)
+{
+    (*handlers)[kind] = handler;
+}
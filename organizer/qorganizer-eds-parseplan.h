@@ -0,0 +1,65 @@
+/*
+ * Copyright 2015 Canonical Ltd.
+ *
+ * This file is part of canonical-pim-service.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __QORGANIZER_EDS_PARSEPLAN_H__
+#define __QORGANIZER_EDS_PARSEPLAN_H__
+
+#include <QtCore/QList>
+#include <QtCore/QVector>
+
+#include <QtOrganizer/QOrganizerCollectionId>
+#include <QtOrganizer/QOrganizerItem>
+#include <QtOrganizer/QOrganizerItemDetail>
+
+#include <libecal/libecal.h>
+
+// The steps needed to turn a component into an item, compiled once from
+// the request detail hint into one handler table per component kind. The
+// component properties are then walked once and each property kind is
+// dispatched to its handler, without the ECalComponent wrapper.
+class ParsePlan
+{
+public:
+    ParsePlan(const QList<QtOrganizer::QOrganizerItemDetail::DetailType> &detailsHint =
+              QList<QtOrganizer::QOrganizerItemDetail::DetailType>());
+
+    QList<QtOrganizer::QOrganizerItemDetail::DetailType> detailsHint() const;
+
+    // fills the given empty item, returns false for components that are
+    // not supported
+    bool parse(icalcomponent *ical,
+               const QtOrganizer::QOrganizerCollectionId &collectionId,
+               QtOrganizer::QOrganizerItem *item) const;
+
+private:
+    typedef void (*Handler)(icalproperty *prop, QtOrganizer::QOrganizerItem *item);
+
+    QList<QtOrganizer::QOrganizerItemDetail::DetailType> m_detailsHint;
+    // indexed by icalproperty_kind
+    QVector<Handler> m_eventHandlers;
+    QVector<Handler> m_todoHandlers;
+    QVector<Handler> m_journalHandlers;
+    bool m_description;
+    bool m_todoStatus;
+    bool m_reminders;
+
+    bool wants(QtOrganizer::QOrganizerItemDetail::DetailType type) const;
+    static void addHandler(QVector<Handler> *handlers, icalproperty_kind kind, Handler handler);
+};
+
+#endif
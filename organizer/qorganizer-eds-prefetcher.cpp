@@ -0,0 +1,147 @@
+/*
+ * Copyright 2015 Canonical Ltd.
+ *
+ * This file is part of canonical-pim-service.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "qorganizer-eds-prefetcher.h"
+#include "qorganizer-eds-engine.h"
+#include "qorganizer-eds-enginedata.h"
+#include "qorganizer-eds-fetchrequestdata.h"
+#include "qorganizer-eds-instancecache.h"
+#include "qorganizer-eds-source-registry.h"
+
+#include <QtCore/QTimer>
+
+#include <QtOrganizer/QOrganizerItemCollectionFilter>
+
+using namespace QtOrganizer;
+
+// Ranges longer than this are not prefetched, in days
+#define PREFETCH_MAX_RANGE          93
+// Prefetches running at the same time
+#define PREFETCH_MAX_JOBS           4
+
+Prefetcher::Prefetcher()
+    : QObject(0)
+{
+}
+
+Prefetcher::~Prefetcher()
+{
+}
+
+void Prefetcher::prefetch(QOrganizerEDSEngine *engine, QOrganizerItemFetchRequest *req)
+{
+    QDateTime startDate = req->startDate();
+    QDateTime endDate = req->endDate();
+    qint64 length = startDate.secsTo(endDate);
+    if ((length <= 0) || (length > PREFETCH_MAX_RANGE * 24 * 60 * 60)) {
+        return;
+    }
+
+    cancelOutside(startDate, endDate);
+    start(engine, req->filter(), startDate.addSecs(-length), startDate);
+    start(engine, req->filter(), endDate, endDate.addSecs(length));
+}
+
+void Prefetcher::cancelOutside(const QDateTime &start, const QDateTime &end)
+{
+    QList<Job> jobs = m_jobs;
+    Q_FOREACH(const Job &job, jobs) {
+        if ((start <= job.request->endDate()) && (end >= job.request->startDate())) {
+            // still next to what is on screen
+            continue;
+        }
+        if (job.engine) {
+            job.engine->cancelRequest(job.request);
+        }
+    }
+}
+
+void Prefetcher::start(QOrganizerEDSEngine *engine,
+                       const QOrganizerItemFilter &filter,
+                       const QDateTime &start,
+                       const QDateTime &end)
+{
+    if (m_jobs.size() >= PREFETCH_MAX_JOBS) {
+        return;
+    }
+
+    Q_FOREACH(const Job &job, m_jobs) {
+        if ((job.request->startDate() == start) && (job.request->endDate() == end)) {
+            return;
+        }
+    }
+
+    // the instances are only kept for the sources being watched, the
+    // others would not even have a connected client
+    QSet<QOrganizerCollectionId> collectionIds;
+    QByteArrayList sourceIds = FetchRequestData::filterSourceIds(engine->d->m_sourceRegistry->sourceIds(),
+                                                                 filter);
+    Q_FOREACH(const QByteArray &sourceId, sourceIds) {
+        if (engine->d->isWatching(QByteArrayList() << sourceId) &&
+            !engine->d->m_instanceCache->covers(sourceId, start.toTime_t(), end.toTime_t())) {
+            collectionIds << engine->d->m_sourceRegistry->collectionId(sourceId);
+        }
+    }
+    if (collectionIds.isEmpty()) {
+        return;
+    }
+
+    // the prefetch only fills the cache, the rest of the filter does not
+    // change the instances listed
+    QOrganizerItemCollectionFilter collectionFilter;
+    collectionFilter.setCollectionIds(collectionIds);
+
+    Job job;
+    job.engine = engine;
+    job.request = new QOrganizerItemFetchRequest(this);
+    job.request->setFilter(collectionFilter);
+    job.request->setStartDate(start);
+    job.request->setEndDate(end);
+    connect(job.request, &QOrganizerAbstractRequest::stateChanged,
+            this, [this, job](QOrganizerAbstractRequest::State state) {
+        onRequestStateChanged(job.request, state);
+    });
+    m_jobs << job;
+
+    engine->itemsAsyncFetch(job.request, true);
+}
+
+void Prefetcher::onRequestStateChanged(QOrganizerItemFetchRequest *request,
+                                       QOrganizerAbstractRequest::State state)
+{
+    if (state == QOrganizerAbstractRequest::ActiveState) {
+        return;
+    }
+
+    QPointer<QOrganizerEDSEngine> engine;
+    for (int i = 0; i < m_jobs.size(); i++) {
+        if (m_jobs[i].request == request) {
+            engine = m_jobs.takeAt(i).engine;
+            break;
+        }
+    }
+
+    // the request has no manager to tell the engine, a cancelled prefetch
+    // may still be waiting for the backend; not from within the state change
+    QTimer::singleShot(0, this, [engine, request]() {
+        if (engine) {
+            engine->requestDestroyed(request);
+        }
+        delete request;
+    });
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright 2015 Canonical Ltd.
+ *
+ * This file is part of canonical-pim-service.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __QORGANIZER_EDS_PREFETCHER_H__
+#define __QORGANIZER_EDS_PREFETCHER_H__
+
+#include <QtCore/QDateTime>
+#include <QtCore/QList>
+#include <QtCore/QObject>
+#include <QtCore/QPointer>
+
+#include <QtOrganizer/QOrganizerItemFetchRequest>
+
+class QOrganizerEDSEngine;
+
+// Lists the ranges next to the one just fetched in the background, so the
+// instance cache already has them when the view scrolls
+class Prefetcher : public QObject
+{
+    Q_OBJECT
+public:
+    Prefetcher();
+    ~Prefetcher();
+
+    void prefetch(QOrganizerEDSEngine *engine, QtOrganizer::QOrganizerItemFetchRequest *req);
+    // the view jumped away from the prefetched ranges
+    void cancelOutside(const QDateTime &start, const QDateTime &end);
+
+private:
+    struct Job {
+        QPointer<QOrganizerEDSEngine> engine;
+        QtOrganizer::QOrganizerItemFetchRequest *request;
+    };
+
+    QList<Job> m_jobs;
+
+    void start(QOrganizerEDSEngine *engine,
+               const QtOrganizer::QOrganizerItemFilter &filter,
+               const QDateTime &start,
+               const QDateTime &end);
+    void onRequestStateChanged(QtOrganizer::QOrganizerItemFetchRequest *request,
+                               QtOrganizer::QOrganizerAbstractRequest::State state);
+};
+
+#endif
@@ -17,6 +17,7 @@
  */
 
 #include "qorganizer-eds-requestdata.h"
+#include "qorganizer-eds-requestscheduler.h"
 
 #include <QtCore/QDebug>
 #include <QtCore/QEventLoop>
@@ -36,12 +37,18 @@ RequestData::RequestData(QOrganizerEDSEngine *engine, QtOrganizer::QOrganizerAbs
 {
     QOrganizerManagerEngine::updateRequestState(req, QOrganizerAbstractRequest::ActiveState);
     m_cancellable = g_cancellable_new();
+    m_context = g_main_context_ref_thread_default();
+    m_sync = m_parent->m_syncRequests.contains(req);
     m_parent->m_runningRequests.insert(req, this);
     m_instanceCount++;
 }
 
 RequestData::~RequestData()
 {
+    if (!m_parent.isNull()) {
+        m_parent->d->m_scheduler->remove(this);
+    }
+
     if (m_cancellable) {
         g_clear_object(&m_cancellable);
     }
@@ -49,6 +56,7 @@ RequestData::~RequestData()
     if (m_client) {
         g_clear_object(&m_client);
     }
+    g_main_context_unref(m_context);
     m_instanceCount--;
 }
 
@@ -105,6 +113,31 @@ void RequestData::wait(int msec)
     delete loop;
 }
 
+bool RequestData::preempt()
+{
+    return false;
+}
+
+void RequestData::resetCancellable()
+{
+    if (m_cancellable) {
+        g_clear_object(&m_cancellable);
+    }
+    m_cancellable = g_cancellable_new();
+}
+
+bool RequestData::isSync() const
+{
+    // set by runRequestSync(), the engine thread may use its own context
+    // for asynchronous requests as well
+    return m_sync;
+}
+
+GMainContext *RequestData::context() const
+{
+    return m_context;
+}
+
 bool RequestData::isWaiting()
 {
     bool result = true;
@@ -127,7 +160,20 @@ void RequestData::deleteLater()
         return;
     }
     if (!m_parent.isNull()) {
-        m_parent->m_runningRequests.remove(m_req);
+        // the request may be gone already, look for the data itself
+        QMap<QOrganizerAbstractRequest*, RequestData*> &running = m_parent->m_runningRequests;
+        if (!m_req.isNull() && (running.value(m_req) == this)) {
+            running.remove(m_req);
+        } else {
+            QMap<QOrganizerAbstractRequest*, RequestData*>::iterator i = running.begin();
+            while (i != running.end()) {
+                if (i.value() == this) {
+                    i = running.erase(i);
+                } else {
+                    ++i;
+                }
+            }
+        }
     }
     delete this;
 }
@@ -139,6 +185,20 @@ void RequestData::finish(QOrganizerManager::Error error,
     Q_UNUSED(state);
     m_finished = true;
 
+    // let the next request use the backends
+    if (!m_parent.isNull()) {
+        m_parent->d->m_scheduler->remove(this);
+    }
+
+    // the watchers report writes later, nothing fetched meanwhile can be
+    // cached
+    if (!m_parent.isNull() && !m_req.isNull() &&
+        ((m_req->type() == QOrganizerAbstractRequest::ItemSaveRequest) ||
+         (m_req->type() == QOrganizerAbstractRequest::ItemRemoveRequest) ||
+         (m_req->type() == QOrganizerAbstractRequest::ItemRemoveByIdRequest))) {
+        m_parent->invalidateCaches(m_req);
+    }
+
     // When cancelling an operation the callback passed for the async function
     // will be called and the request data object will be destroyed there
     if (state != QOrganizerAbstractRequest::CanceledState) {
@@ -40,10 +40,14 @@ public:
     ECalClient *client() const;
     QOrganizerEDSEngine *parent() const;
     virtual void cancel();
+    // stop using the backend for now, the request will be started again
+    virtual bool preempt();
     void deleteLater();
     virtual void finish(QtOrganizer::QOrganizerManager::Error error, QtOrganizer::QOrganizerAbstractRequest::State state);
     void wait(int msec = 0);
     bool isWaiting();
+    bool isSync() const;
+    GMainContext *context() const;
 
     template<class T>
     T* request() const {
@@ -72,10 +76,13 @@ protected:
     bool m_finished;
 
     virtual ~RequestData();
+    void resetCancellable();
 
 private:
     QPointer<QtOrganizer::QOrganizerAbstractRequest> m_req;
     GCancellable *m_cancellable;
+    GMainContext *m_context;
+    bool m_sync;
 
     static int m_instanceCount;
 };
@@ -0,0 +1,198 @@
+/*
+ * Copyright 2015 Canonical Ltd.
+ *
+ * This file is part of canonical-pim-service.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "qorganizer-eds-requestscheduler.h"
+#include "qorganizer-eds-requestdata.h"
+
+// Requests running against the same backend
+#define REQUESTS_PER_SOURCE         2
+// A waiting background request starts before any other after being passed
+// over this many times
+#define BACKGROUND_PASS_LIMIT       4
+
+RequestScheduler::RequestScheduler()
+    : m_passedOver(0)
+{
+}
+
+RequestScheduler::~RequestScheduler()
+{
+}
+
+void RequestScheduler::submit(RequestData *data,
+                              Priority priority,
+                              const QByteArrayList &sourceIds,
+                              StartFunction start)
+{
+    Job job;
+    job.data = data;
+    job.priority = priority;
+    job.sourceIds = sourceIds;
+    job.start = start;
+
+    // synchronous calls block the caller and can not wait for other requests
+    if ((priority == Interactive) || data->isSync()) {
+        preemptFor(job);
+        run(job);
+    } else {
+        m_queue << job;
+        schedule();
+    }
+}
+
+void RequestScheduler::requeue(RequestData *data)
+{
+    int index = indexOf(m_preempted, data);
+    if (index == -1) {
+        index = indexOf(m_running, data);
+        if (index == -1) {
+            return;
+        }
+        m_queue.prepend(m_running.takeAt(index));
+    } else {
+        m_queue.prepend(m_preempted.takeAt(index));
+    }
+    schedule();
+}
+
+void RequestScheduler::remove(RequestData *data)
+{
+    int index = indexOf(m_queue, data);
+    if (index != -1) {
+        m_queue.removeAt(index);
+        return;
+    }
+
+    index = indexOf(m_preempted, data);
+    if (index != -1) {
+        m_preempted.removeAt(index);
+        return;
+    }
+
+    index = indexOf(m_running, data);
+    if (index != -1) {
+        m_running.removeAt(index);
+        schedule();
+    }
+}
+
+bool RequestScheduler::isQueued(RequestData *data) const
+{
+    return (indexOf(m_queue, data) != -1);
+}
+
+int RequestScheduler::load(const QByteArray &sourceId) const
+{
+    int count = 0;
+    Q_FOREACH(const Job &job, m_running) {
+        if (job.sourceIds.contains(sourceId)) {
+            count++;
+        }
+    }
+    return count;
+}
+
+bool RequestScheduler::canStart(const Job &job) const
+{
+    Q_FOREACH(const QByteArray &sourceId, job.sourceIds) {
+        if (load(sourceId) >= REQUESTS_PER_SOURCE) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void RequestScheduler::preemptFor(const Job &job)
+{
+    Q_FOREACH(const QByteArray &sourceId, job.sourceIds) {
+        if (load(sourceId) < REQUESTS_PER_SOURCE) {
+            continue;
+        }
+
+        // give way to the newest background request using this backend
+        for (int i = m_running.size() - 1; i >= 0; i--) {
+            const Job &running = m_running[i];
+            if ((running.priority == Background) &&
+                running.sourceIds.contains(sourceId) &&
+                running.data->preempt()) {
+                m_preempted << m_running.takeAt(i);
+                break;
+            }
+        }
+    }
+}
+
+void RequestScheduler::run(const Job &job)
+{
+    m_running << job;
+    // may finish right away and call remove()
+    job.start(job.data);
+}
+
+void RequestScheduler::schedule()
+{
+    while (!m_queue.isEmpty()) {
+        int next = -1;
+
+        // fairness, do not let background requests wait forever
+        if (m_passedOver >= BACKGROUND_PASS_LIMIT) {
+            for (int i = 0; i < m_queue.size(); i++) {
+                if ((m_queue[i].priority == Background) && canStart(m_queue[i])) {
+                    next = i;
+                    break;
+                }
+            }
+        }
+
+        for (int priority = Interactive; (next == -1) && (priority <= Background); priority++) {
+            for (int i = 0; i < m_queue.size(); i++) {
+                if ((m_queue[i].priority == priority) && canStart(m_queue[i])) {
+                    next = i;
+                    break;
+                }
+            }
+        }
+
+        if (next == -1) {
+            break;
+        }
+
+        Job job = m_queue.takeAt(next);
+        if (job.priority == Background) {
+            m_passedOver = 0;
+        } else {
+            Q_FOREACH(const Job &queued, m_queue) {
+                if (queued.priority == Background) {
+                    m_passedOver++;
+                    break;
+                }
+            }
+        }
+        run(job);
+    }
+}
+
+int RequestScheduler::indexOf(const QList<Job> &jobs, RequestData *data)
+{
+    for (int i = 0; i < jobs.size(); i++) {
+        if (jobs[i].data == data) {
+            return i;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright 2015 Canonical Ltd.
+ *
+ * This file is part of canonical-pim-service.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __QORGANIZER_EDS_REQUESTSCHEDULER_H__
+#define __QORGANIZER_EDS_REQUESTSCHEDULER_H__
+
+#include <QtCore/QByteArray>
+#include <QtCore/QList>
+
+class RequestData;
+
+// Limits how many read requests hit each backend at the same time.
+// Interactive requests always start right away, the others wait for a free
+// slot on every backend they need; background requests can be preempted.
+class RequestScheduler
+{
+public:
+    enum Priority {
+        Interactive = 0,    // fetch by id
+        Visible,            // fetch of a date range
+        Background          // fetch of everything
+    };
+
+    typedef void (*StartFunction)(RequestData *data);
+
+    RequestScheduler();
+    ~RequestScheduler();
+
+    void submit(RequestData *data,
+                Priority priority,
+                const QByteArrayList &sourceIds,
+                StartFunction start);
+    // the request gave its backends back, it will start again when possible
+    void requeue(RequestData *data);
+    // the request is done with the backends, finished or cancelled
+    void remove(RequestData *data);
+    bool isQueued(RequestData *data) const;
+
+private:
+    struct Job {
+        RequestData *data;
+        Priority priority;
+        QByteArrayList sourceIds;
+        StartFunction start;
+    };
+
+    QList<Job> m_queue;
+    QList<Job> m_running;
+    QList<Job> m_preempted;
+    int m_passedOver;
+
+    int load(const QByteArray &sourceId) const;
+    bool canStart(const Job &job) const;
+    void preemptFor(const Job &job);
+    void run(const Job &job);
+    void schedule();
+    static int indexOf(const QList<Job> &jobs, RequestData *data);
+};
+
+#endif
@@ -0,0 +1,209 @@
+/*
+ * Copyright 2015 Canonical Ltd.
+ *
+ * This file is part of canonical-pim-service.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "qorganizer-eds-sharedfetch.h"
+#include "qorganizer-eds-enginedata.h"
+
+#include <QtCore/QDataStream>
+#include <QtCore/QDebug>
+
+#include <QtOrganizer/QOrganizerManagerEngine>
+
+using namespace QtOrganizer;
+
+SharedFetch::SharedFetch(QOrganizerEDSEngine *engine,
+                         const QByteArray &key,
+                         QOrganizerItemFetchRequest *req)
+    : QObject(0),
+      m_engine(engine),
+      m_data(engine->d),
+      m_key(key),
+      m_request(0),
+      m_generation(0),
+      m_cacheable(false)
+{
+    m_request = createRequest(req);
+}
+
+SharedFetch::~SharedFetch()
+{
+    // the request has no manager to tell the engine, a cancelled fetch may
+    // still be waiting for the backend
+    if (m_engine) {
+        m_engine->requestDestroyed(m_request);
+    }
+}
+
+void SharedFetch::start()
+{
+    // results are only worth keeping if nothing changed meanwhile, and
+    // the views were there to tell
+    m_generation = m_data->fetchResultsGeneration();
+    m_sourceIds = m_engine->requestSourceIds(m_request);
+    m_cacheable = m_data->canCacheFetchResults(m_sourceIds);
+    m_engine->itemsAsyncFetch(m_request);
+}
+
+QOrganizerItemFetchRequest *SharedFetch::createRequest(QOrganizerItemFetchRequest *req)
+{
+    QOrganizerItemFetchRequest *request = new QOrganizerItemFetchRequest(this);
+    request->setFilter(req->filter());
+    request->setStartDate(req->startDate());
+    request->setEndDate(req->endDate());
+    request->setMaxCount(req->maxCount());
+    request->setSorting(req->sorting());
+    request->setFetchHint(req->fetchHint());
+
+    connect(request, &QOrganizerAbstractRequest::stateChanged,
+            this, &SharedFetch::onRequestStateChanged);
+    return request;
+}
+
+void SharedFetch::subscribe(QOrganizerEDSEngine *engine, QOrganizerItemFetchRequest *req)
+{
+    m_subscribers << new FetchSubscriberData(engine, req, this);
+}
+
+void SharedFetch::unsubscribe(FetchSubscriberData *subscriber)
+{
+    m_subscribers.removeAll(subscriber);
+    if (m_subscribers.isEmpty() &&
+        (m_request->state() == QOrganizerAbstractRequest::ActiveState) &&
+        m_engine) {
+        // nobody else is waiting for the results
+        m_engine->cancelRequest(m_request);
+    }
+}
+
+void SharedFetch::engineDestroyed(QOrganizerEDSEngine *engine)
+{
+    if (m_engine != engine) {
+        return;
+    }
+
+    QOrganizerEDSEngine *next = 0;
+    Q_FOREACH(FetchSubscriberData *subscriber, m_subscribers) {
+        if (subscriber->parent() && (subscriber->parent() != engine)) {
+            next = subscriber->parent();
+            break;
+        }
+    }
+    if (!next) {
+        // the requests left are cancelled together with the engine
+        return;
+    }
+
+    // the subscribers must not see the old fetch being cancelled
+    QOrganizerItemFetchRequest *request = m_request;
+    m_request = createRequest(request);
+    request->disconnect(this);
+    engine->requestDestroyed(request);
+    delete request;
+
+    m_engine = next;
+    start();
+}
+
+void SharedFetch::onRequestStateChanged(QOrganizerAbstractRequest::State state)
+{
+    if (state == QOrganizerAbstractRequest::ActiveState) {
+        return;
+    }
+
+    // new requests start a new fetch from now on
+    if (m_data->m_sharedFetches.value(m_key) == this) {
+        m_data->m_sharedFetches.remove(m_key);
+    }
+
+    if (m_cacheable &&
+        (state == QOrganizerAbstractRequest::FinishedState) &&
+        (m_request->error() == QOrganizerManager::NoError)) {
+        m_data->storeFetchResults(m_key, m_sourceIds, m_request->items(), m_generation);
+    }
+
+    QList<FetchSubscriberData*> subscribers = m_subscribers;
+    m_subscribers.clear();
+    Q_FOREACH(FetchSubscriberData *subscriber, subscribers) {
+        subscriber->setResults(m_request->items());
+        subscriber->finish(m_request->error(), state);
+        if (state == QOrganizerAbstractRequest::CanceledState) {
+            // there is no pending callback to release it
+            subscriber->deleteLater();
+        }
+    }
+    deleteLater();
+}
+
+QByteArray SharedFetch::key(QOrganizerEDSEngine *engine, QOrganizerItemFetchRequest *req)
+{
+    QByteArray result;
+    QDataStream stream(&result, QIODevice::WriteOnly);
+    // the ids in the results carry the manager uri, and the engines asking
+    // for busy periods get other results
+    stream << engine->managerUri()
+           << engine->m_freeBusy
+           << req->filter()
+           << req->startDate()
+           << req->endDate()
+           << req->maxCount()
+           << req->sorting()
+           << req->fetchHint();
+    return result;
+}
+
+FetchSubscriberData::FetchSubscriberData(QOrganizerEDSEngine *engine,
+                                         QOrganizerAbstractRequest *req,
+                                         SharedFetch *shared)
+    : RequestData(engine, req),
+      m_shared(shared),
+      m_cached(shared == 0)
+{
+}
+
+void FetchSubscriberData::cancel()
+{
+    // the others keep waiting for the shared fetch
+    if (m_shared) {
+        m_shared->unsubscribe(this);
+        m_shared = 0;
+    }
+
+    RequestData::cancel();
+    if (!m_cached) {
+        // no callback will release it
+        deleteLater();
+    }
+}
+
+void FetchSubscriberData::finish(QOrganizerManager::Error error,
+                                 QOrganizerAbstractRequest::State state)
+{
+    QOrganizerItemFetchRequest *req = request<QOrganizerItemFetchRequest>();
+    if (req) {
+        QOrganizerManagerEngine::updateItemFetchRequest(req,
+                                                        m_results,
+                                                        error,
+                                                        state);
+    }
+    RequestData::finish(error, state);
+}
+
+void FetchSubscriberData::setResults(const QList<QOrganizerItem> &results)
+{
+    m_results = results;
+}
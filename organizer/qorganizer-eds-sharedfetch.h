@@ -0,0 +1,86 @@
+/*
+ * Copyright 2015 Canonical Ltd.
+ *
+ * This file is part of canonical-pim-service.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __QORGANIZER_EDS_SHAREDFETCH_H__
+#define __QORGANIZER_EDS_SHAREDFETCH_H__
+
+#include "qorganizer-eds-requestdata.h"
+
+#include <QtCore/QObject>
+#include <QtCore/QPointer>
+
+#include <QtOrganizer/QOrganizerItemFetchRequest>
+
+class FetchSubscriberData;
+
+// One fetch running on behalf of every identical request issued while it
+// is in flight, no matter which engine received them
+class SharedFetch : public QObject
+{
+    Q_OBJECT
+public:
+    SharedFetch(QOrganizerEDSEngine *engine,
+                const QByteArray &key,
+                QtOrganizer::QOrganizerItemFetchRequest *req);
+    ~SharedFetch();
+
+    void start();
+    void subscribe(QOrganizerEDSEngine *engine, QtOrganizer::QOrganizerItemFetchRequest *req);
+    void unsubscribe(FetchSubscriberData *subscriber);
+    // moves the fetch to another engine still waiting for it
+    void engineDestroyed(QOrganizerEDSEngine *engine);
+
+    static QByteArray key(QOrganizerEDSEngine *engine,
+                          QtOrganizer::QOrganizerItemFetchRequest *req);
+
+private Q_SLOTS:
+    void onRequestStateChanged(QtOrganizer::QOrganizerAbstractRequest::State state);
+
+private:
+    QPointer<QOrganizerEDSEngine> m_engine;
+    QOrganizerEDSEngineData *m_data;
+    QByteArray m_key;
+    QtOrganizer::QOrganizerItemFetchRequest *m_request;
+    QList<FetchSubscriberData*> m_subscribers;
+    QByteArrayList m_sourceIds;
+    uint m_generation;
+    bool m_cacheable;
+
+    QtOrganizer::QOrganizerItemFetchRequest *createRequest(QtOrganizer::QOrganizerItemFetchRequest *req);
+};
+
+class FetchSubscriberData : public RequestData
+{
+public:
+    // without a shared fetch the results come from the fetch results cache
+    FetchSubscriberData(QOrganizerEDSEngine *engine,
+                        QtOrganizer::QOrganizerAbstractRequest *req,
+                        SharedFetch *shared);
+
+    void cancel();
+    void finish(QtOrganizer::QOrganizerManager::Error error = QtOrganizer::QOrganizerManager::NoError,
+                QtOrganizer::QOrganizerAbstractRequest::State state = QtOrganizer::QOrganizerAbstractRequest::FinishedState);
+    void setResults(const QList<QtOrganizer::QOrganizerItem> &results);
+
+private:
+    QPointer<SharedFetch> m_shared;
+    bool m_cached;
+    QList<QtOrganizer::QOrganizerItem> m_results;
+};
+
+#endif
@@ -2,12 +2,35 @@
 #include "config.h"
 
 #include <QtCore/QDebug>
+
+#include <string.h>
 #include <evolution-data-server-ubuntu/e-source-ubuntu.h>
 
 using namespace QtOrganizer;
 
 static const QString DEFAULT_COLLECTION_SETTINGS("qtpim/default-colection");
 
+static ECalClientSourceType clientSourceType(ESource *source)
+{
+    if (e_source_has_extension(source, E_SOURCE_EXTENSION_CALENDAR)) {
+        return E_CAL_CLIENT_SOURCE_TYPE_EVENTS;
+    } else if (e_source_has_extension(source, E_SOURCE_EXTENSION_TASK_LIST)) {
+        return E_CAL_CLIENT_SOURCE_TYPE_TASKS;
+    } else if (e_source_has_extension(source, E_SOURCE_EXTENSION_MEMO_LIST)) {
+        return E_CAL_CLIENT_SOURCE_TYPE_MEMOS;
+    }
+    qWarning() << "Source extension not supported";
+    Q_ASSERT(false);
+    return E_CAL_CLIENT_SOURCE_TYPE_EVENTS;
+}
+
+struct ClientConnectData
+{
+    SourceRegistry *self;
+    QByteArray sourceId;
+    GCancellable *cancellable;
+};
+
 SourceRegistry::SourceRegistry(QObject *parent)
     : QObject(parent),
       m_sourceRegistry(0),
@@ -18,6 +41,13 @@ SourceRegistry::SourceRegistry(QObject *parent)
       m_sourceDisabledId(0),
       m_defaultSourceChangedId(0)
 {
+    // connected before anybody else, so listeners already see the new set
+    connect(this, &SourceRegistry::sourceAdded,
+            this, &SourceRegistry::updateCollectionsSnapshot);
+    connect(this, &SourceRegistry::sourceRemoved,
+            this, &SourceRegistry::updateCollectionsSnapshot);
+    connect(this, &SourceRegistry::sourceUpdated,
+            this, &SourceRegistry::updateCollectionsSnapshot);
 }
 
 SourceRegistry::~SourceRegistry()
@@ -129,7 +159,17 @@ QOrganizerCollection SourceRegistry::collection(const QByteArray &sourceId) cons
 
 QList<QOrganizerCollection> SourceRegistry::collections() const
 {
-    return m_collections.values();
+    // only bump the reference count under the lock, the list itself is
+    // rebuilt by updateCollectionsSnapshot() on the registry thread
+    QMutexLocker locker(&m_collectionsSnapshotLock);
+    return m_collectionsSnapshot;
+}
+
+void SourceRegistry::updateCollectionsSnapshot()
+{
+    QList<QOrganizerCollection> snapshot = m_collections.values();
+    QMutexLocker locker(&m_collectionsSnapshotLock);
+    m_collectionsSnapshot.swap(snapshot);
 }
 
 QByteArrayList SourceRegistry::sourceIds() const
@@ -195,6 +235,10 @@ void SourceRegistry::remove(const QByteArray &sourceId)
         return;
     }
 
+    bool wasPending = m_pendingClients.contains(sourceId);
+    cancelPendingClient(sourceId);
+    m_failedClients.remove(sourceId);
+
     QOrganizerCollection collection = m_collections.take(sourceId);
     if (!collection.id().isNull()) {
         Q_EMIT sourceRemoved(sourceId);
@@ -210,6 +254,11 @@ void SourceRegistry::remove(const QByteArray &sourceId)
         m_defaultCollection = QOrganizerCollection();
         setDefaultCollection(m_collections.first());
     }
+
+    // release anybody waiting for this client
+    if (wasPending) {
+        Q_EMIT clientReady(sourceId);
+    }
 }
 
 EClient* SourceRegistry::client(const QByteArray &sourceId)
@@ -224,31 +273,22 @@ EClient* SourceRegistry::client(const QByteArray &sourceId)
         if (i != m_sources.end()) {
             GError *gError = 0;
 
-            ESource *source = i.value();
-            ECalClientSourceType sourceType;
-            if (e_source_has_extension(source, E_SOURCE_EXTENSION_CALENDAR)) {
-                sourceType = E_CAL_CLIENT_SOURCE_TYPE_EVENTS;
-            } else if (e_source_has_extension(source, E_SOURCE_EXTENSION_TASK_LIST)) {
-                sourceType = E_CAL_CLIENT_SOURCE_TYPE_TASKS;
-            } else if (e_source_has_extension(source, E_SOURCE_EXTENSION_MEMO_LIST)) {
-                sourceType = E_CAL_CLIENT_SOURCE_TYPE_MEMOS;
-            } else {
-                qWarning() << "Source extension not supported";
-                Q_ASSERT(false);
-            }
+            // the caller can not wait, replace any connection in progress
+            bool wasPending = m_pendingClients.contains(sourceId);
+            cancelPendingClient(sourceId);
 
-            client = E_CAL_CLIENT_CONNECT_SYNC(source, sourceType, 0, &gError);
+            ESource *source = i.value();
+            client = E_CAL_CLIENT_CONNECT_SYNC(source, clientSourceType(source), 0, &gError);
             if (gError) {
                 qWarning() << "Fail to connect with client" << gError->message;
                 g_error_free(gError);
+                m_failedClients.insert(sourceId);
             } else {
-                // If the client is read only update the collection
-                if (e_client_is_readonly(client)) {
-                    QOrganizerCollection &c = m_collections[sourceId];
-                    c.setExtendedMetaData(COLLECTION_READONLY_METADATA, true);
-                    Q_EMIT sourceUpdated(sourceId);
-                }
-                m_clients.insert(sourceId, client);
+                insertClient(sourceId, client);
+            }
+
+            if (wasPending) {
+                Q_EMIT clientReady(sourceId);
             }
         }
     }
@@ -258,8 +298,79 @@ EClient* SourceRegistry::client(const QByteArray &sourceId)
     return client;
 }
 
+SourceRegistry::ClientState SourceRegistry::clientState(const QByteArray &sourceId) const
+{
+    if (m_clients.contains(sourceId)) {
+        return ClientConnected;
+    } else if (m_pendingClients.contains(sourceId)) {
+        return ClientConnecting;
+    } else if (m_failedClients.contains(sourceId)) {
+        return ClientFailed;
+    }
+    return ClientDisconnected;
+}
+
+void SourceRegistry::connectClient(const QByteArray &sourceId)
+{
+    if (m_clients.contains(sourceId) || m_pendingClients.contains(sourceId)) {
+        return;
+    }
+
+    ESource *source = m_sources.value(sourceId, 0);
+    if (!source) {
+        return;
+    }
+
+    m_failedClients.remove(sourceId);
+
+    ClientConnectData *data = new ClientConnectData;
+    data->self = this;
+    data->sourceId = sourceId;
+    data->cancellable = g_cancellable_new();
+    m_pendingClients.insert(sourceId, G_CANCELLABLE(g_object_ref(data->cancellable)));
+
+    E_CAL_CLIENT_CONNECT(source,
+                         clientSourceType(source),
+                         data->cancellable,
+                         (GAsyncReadyCallback) SourceRegistry::onClientConnected,
+                         data);
+}
+
+void SourceRegistry::prewarm(const QByteArrayList &sourceIds)
+{
+    Q_FOREACH(const QByteArray &sourceId, sourceIds) {
+        connectClient(sourceId);
+    }
+}
+
+void SourceRegistry::insertClient(const QByteArray &sourceId, EClient *client)
+{
+    // If the client is read only update the collection
+    if (e_client_is_readonly(client)) {
+        QOrganizerCollection &c = m_collections[sourceId];
+        c.setExtendedMetaData(COLLECTION_READONLY_METADATA, true);
+        Q_EMIT sourceUpdated(sourceId);
+    }
+    m_failedClients.remove(sourceId);
+    m_clients.insert(sourceId, client);
+}
+
+void SourceRegistry::cancelPendingClient(const QByteArray &sourceId)
+{
+    GCancellable *cancellable = m_pendingClients.take(sourceId);
+    if (cancellable) {
+        g_cancellable_cancel(cancellable);
+        g_object_unref(cancellable);
+    }
+}
+
 void SourceRegistry::clear()
 {
+    Q_FOREACH(const QByteArray &sourceId, m_pendingClients.keys()) {
+        cancelPendingClient(sourceId);
+    }
+    m_failedClients.clear();
+
     Q_FOREACH(ESource *source, m_sources.values()) {
         g_object_unref(source);
     }
@@ -270,6 +381,7 @@ void SourceRegistry::clear()
 
     m_sources.clear();
     m_collections.clear();
+    updateCollectionsSnapshot();
     m_clients.clear();
 
     for (ESource *source: m_expectedNewSources) {
@@ -280,7 +392,19 @@ void SourceRegistry::clear()
 
 QByteArray SourceRegistry::findSource(ESource *source) const
 {
-    QMap<QByteArray, ESource*>::ConstIterator i = m_sources.constBegin();
+    // sources are registered under their uid and e_source_equal() compares
+    // uids, so a hash lookup gives the same answer without walking the list
+    const gchar *uid = e_source_get_uid(source);
+    if (uid) {
+        QHash<QByteArray, ESource*>::ConstIterator i =
+            m_sources.constFind(QByteArray::fromRawData(uid, strlen(uid)));
+        if (i != m_sources.constEnd()) {
+            return i.key();
+        }
+        return QByteArray();
+    }
+
+    QHash<QByteArray, ESource*>::ConstIterator i = m_sources.constBegin();
     while (i != m_sources.constEnd()) {
         if (e_source_equal(source, i.value())) {
             return i.key();
@@ -454,6 +578,49 @@ void SourceRegistry::onDefaultCalendarChanged(ESourceRegistry *registry,
     g_object_unref(defaultCalendar);
 }
 
+void SourceRegistry::onClientConnected(GObject *sourceObject,
+                                       GAsyncResult *res,
+                                       gpointer userData)
+{
+    Q_UNUSED(sourceObject);
+    ClientConnectData *data = static_cast<ClientConnectData*>(userData);
+
+    GError *gError = 0;
+    EClient *client = e_cal_client_connect_finish(res, &gError);
+
+    // the registry was destroyed or somebody else connected the client already
+    if (g_cancellable_is_cancelled(data->cancellable)) {
+        if (gError) {
+            g_error_free(gError);
+        }
+        if (client) {
+            g_object_unref(client);
+        }
+        g_object_unref(data->cancellable);
+        delete data;
+        return;
+    }
+
+    SourceRegistry *self = data->self;
+    QByteArray sourceId = data->sourceId;
+    g_object_unref(data->cancellable);
+    delete data;
+
+    GCancellable *cancellable = self->m_pendingClients.take(sourceId);
+    if (cancellable) {
+        g_object_unref(cancellable);
+    }
+
+    if (gError) {
+        qWarning() << "Fail to connect with client" << gError->message;
+        g_error_free(gError);
+        self->m_failedClients.insert(sourceId);
+    } else {
+        self->insertClient(sourceId, client);
+    }
+    Q_EMIT self->clientReady(sourceId);
+}
+
 void SourceRegistry::updateCollection(QOrganizerCollection *collection,
                                       bool isDefault,
                                       ESource *source,
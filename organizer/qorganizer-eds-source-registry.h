@@ -19,7 +19,10 @@
 #ifndef __QORGANIZER_EDS_SOURCEREGISTRY_H__
 #define __QORGANIZER_EDS_SOURCEREGISTRY_H__
 
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
 #include <QtCore/QObject>
+#include <QtCore/QSet>
 #include <QtCore/QSettings>
 
 #include <QtOrganizer/QOrganizerCollection>
@@ -38,6 +41,13 @@ class SourceRegistry : public QObject
 {
     Q_OBJECT
 public:
+    enum ClientState {
+        ClientDisconnected = 0,
+        ClientConnecting,
+        ClientConnected,
+        ClientFailed
+    };
+
     SourceRegistry(QObject *parent=0);
     ~SourceRegistry();
 
@@ -55,6 +65,9 @@ public:
     void remove(ESource *source);
     void remove(const QByteArray &sourceId);
     EClient *client(const QByteArray &sourceId);
+    ClientState clientState(const QByteArray &sourceId) const;
+    void connectClient(const QByteArray &sourceId);
+    void prewarm(const QByteArrayList &sourceIds);
     void clear();
 
     static QtOrganizer::QOrganizerCollection parseSource(const QString &managerUri,
@@ -66,6 +79,8 @@ Q_SIGNALS:
     void sourceAdded(const QByteArray &sourceId);
     void sourceRemoved(const QByteArray &sourceId);
     void sourceUpdated(const QByteArray &sourceId);
+    // emitted once a pending connection finishes, check clientState() for the result
+    void clientReady(const QByteArray &sourceId);
 
 private:
     QSettings m_settings;
@@ -73,8 +88,15 @@ private:
     ESourceRegistry *m_sourceRegistry;
     QtOrganizer::QOrganizerCollection m_defaultCollection;
     QMap<QByteArray, EClient*> m_clients;
-    QMap<QByteArray, ESource*> m_sources;
+    QMap<QByteArray, GCancellable*> m_pendingClients;
+    QSet<QByteArray> m_failedClients;
+    QHash<QByteArray, ESource*> m_sources;
     QMap<QByteArray, QtOrganizer::QOrganizerCollection> m_collections;
+    // implicitly shared copy of m_collections handed out by collections(),
+    // rebuilt on the registry thread whenever a source changes; readers on
+    // other threads only copy it while holding the lock
+    QList<QtOrganizer::QOrganizerCollection> m_collectionsSnapshot;
+    mutable QMutex m_collectionsSnapshotLock;
     QList<ESource*> m_expectedNewSources;
 
     // handler id
@@ -88,8 +110,11 @@ private:
     QByteArray defaultSourceId() const;
     QByteArray findSource(ESource *source) const;
     void insert(ESource *source);
+    void insertClient(const QByteArray &sourceId, EClient *client);
+    void cancelPendingClient(const QByteArray &sourceId);
     QtOrganizer::QOrganizerCollection registerSource(ESource *source, bool isDefault = false);
     void updateDefaultCollection(QtOrganizer::QOrganizerCollection *collection);
+    void updateCollectionsSnapshot();
     static void updateCollection(QtOrganizer::QOrganizerCollection *collection,
                                  bool isDefault,
                                  ESource *source,
@@ -112,6 +137,9 @@ private:
     static void onDefaultCalendarChanged(ESourceRegistry *registry,
                                          GParamSpec *pspec,
                                          SourceRegistry *self);
+    static void onClientConnected(GObject *sourceObject,
+                                  GAsyncResult *res,
+                                  gpointer userData);
 };
 
 #endif
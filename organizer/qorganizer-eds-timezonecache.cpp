@@ -0,0 +1,137 @@
+/*
+ * Copyright 2015 Canonical Ltd.
+ *
+ * This file is part of canonical-pim-service.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "qorganizer-eds-timezonecache.h"
+
+#include <QtCore/QReadLocker>
+#include <QtCore/QWriteLocker>
+
+#include <string.h>
+
+// how long the system zone is trusted before asking Qt for it again (ms)
+#define SYSTEM_ZONE_REFRESH_INTERVAL    5000
+
+QReadWriteLock TimeZoneCache::m_lock;
+QHash<QByteArray, TimeZoneCache::IcalZone> TimeZoneCache::m_icalZones;
+QHash<QByteArray, icaltimezone*> TimeZoneCache::m_builtinZones;
+QHash<QByteArray, QTimeZone> TimeZoneCache::m_zones;
+QTimeZone TimeZoneCache::m_system;
+QByteArray TimeZoneCache::m_systemTz;
+QElapsedTimer TimeZoneCache::m_systemAge;
+
+icaltimezone *TimeZoneCache::fromTzId(const char *tzId, QTimeZone *qTz)
+{
+    QByteArray key(tzId);
+    {
+        QReadLocker locker(&m_lock);
+        QHash<QByteArray, IcalZone>::const_iterator i = m_icalZones.constFind(key);
+        if (i != m_icalZones.constEnd()) {
+            *qTz = i.value().qTz;
+            return i.value().zone;
+        }
+    }
+
+    // libical lookups are not thread safe either
+    QWriteLocker locker(&m_lock);
+    icaltimezone *timezone = icaltimezone_get_builtin_timezone_from_tzid(tzId);
+    if (!timezone) {
+        // fallback: sometimes the tzId contains the location name
+        static const char prefix[] = "/freeassociation.sourceforge.net/Tzfile/";
+        if (strncmp(tzId, prefix, sizeof(prefix) - 1) == 0) {
+            tzId += sizeof(prefix) - 1;
+        }
+        timezone = icaltimezone_get_builtin_timezone(tzId);
+    }
+
+    IcalZone entry;
+    entry.zone = timezone;
+    entry.qTz = zoneLocked(QByteArray(icaltimezone_get_location(timezone)));
+    m_icalZones.insert(key, entry);
+
+    *qTz = entry.qTz;
+    return timezone;
+}
+
+icaltimezone *TimeZoneCache::builtin(const QByteArray &ianaId)
+{
+    {
+        QReadLocker locker(&m_lock);
+        QHash<QByteArray, icaltimezone*>::const_iterator i = m_builtinZones.constFind(ianaId);
+        if (i != m_builtinZones.constEnd()) {
+            return i.value();
+        }
+    }
+
+    QWriteLocker locker(&m_lock);
+    icaltimezone *timezone = icaltimezone_get_builtin_timezone(ianaId.constData());
+    m_builtinZones.insert(ianaId, timezone);
+    return timezone;
+}
+
+QTimeZone TimeZoneCache::zone(const QByteArray &ianaId)
+{
+    {
+        QReadLocker locker(&m_lock);
+        QHash<QByteArray, QTimeZone>::const_iterator i = m_zones.constFind(ianaId);
+        if (i != m_zones.constEnd()) {
+            return i.value();
+        }
+    }
+
+    QWriteLocker locker(&m_lock);
+    return zoneLocked(ianaId);
+}
+
+QTimeZone TimeZoneCache::utc()
+{
+    return zone(QByteArrayLiteral("UTC"));
+}
+
+QTimeZone TimeZoneCache::system()
+{
+    // QTimeZone::systemTimeZoneId() reads the zone files on every call, keep
+    // the answer for a while but notice a TZ change right away
+    QByteArray tz = qgetenv("TZ");
+    {
+        QReadLocker locker(&m_lock);
+        if (m_systemAge.isValid() &&
+            (tz == m_systemTz) &&
+            !m_systemAge.hasExpired(SYSTEM_ZONE_REFRESH_INTERVAL)) {
+            return m_system;
+        }
+    }
+
+    QByteArray id = QTimeZone::systemTimeZoneId();
+    QWriteLocker locker(&m_lock);
+    m_system = zoneLocked(id);
+    m_systemTz = tz;
+    m_systemAge.start();
+    return m_system;
+}
+
+QTimeZone TimeZoneCache::zoneLocked(const QByteArray &ianaId)
+{
+    QHash<QByteArray, QTimeZone>::const_iterator i = m_zones.constFind(ianaId);
+    if (i != m_zones.constEnd()) {
+        return i.value();
+    }
+
+    QTimeZone qTz(ianaId);
+    m_zones.insert(ianaId, qTz);
+    return qTz;
+}
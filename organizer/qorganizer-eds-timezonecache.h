@@ -0,0 +1,61 @@
+/*
+ * Copyright 2015 Canonical Ltd.
+ *
+ * This file is part of canonical-pim-service.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __QORGANIZER_EDS_TIMEZONECACHE_H__
+#define __QORGANIZER_EDS_TIMEZONECACHE_H__
+
+#include <QtCore/QByteArray>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QHash>
+#include <QtCore/QReadWriteLock>
+#include <QtCore/QTimeZone>
+
+#include <libical/ical.h>
+
+// Time zones resolved once per process. Creating a QTimeZone loads the
+// zone from tzdata and the libical lookups walk the builtin zone list, the
+// parse threads and the write path share the results here.
+class TimeZoneCache
+{
+public:
+    // the builtin zone of an iCal TZID, with the matching QTimeZone
+    static icaltimezone *fromTzId(const char *tzId, QTimeZone *qTz);
+    // the builtin zone of an IANA id
+    static icaltimezone *builtin(const QByteArray &ianaId);
+    static QTimeZone zone(const QByteArray &ianaId);
+    static QTimeZone utc();
+    static QTimeZone system();
+
+private:
+    struct IcalZone {
+        icaltimezone *zone;
+        QTimeZone qTz;
+    };
+
+    static QReadWriteLock m_lock;
+    static QHash<QByteArray, IcalZone> m_icalZones;
+    static QHash<QByteArray, icaltimezone*> m_builtinZones;
+    static QHash<QByteArray, QTimeZone> m_zones;
+    static QTimeZone m_system;
+    static QByteArray m_systemTz;
+    static QElapsedTimer m_systemAge;
+
+    static QTimeZone zoneLocked(const QByteArray &ianaId);
+};
+
+#endif
@@ -19,8 +19,11 @@
 #include "qorganizer-eds-enginedata.h"
 #include "qorganizer-eds-viewwatcher.h"
 #include "qorganizer-eds-fetchrequestdata.h"
+#include "qorganizer-eds-source-registry.h"
+#include "qorganizer-eds-instancecache.h"
 
 #include <QtCore/QCoreApplication>
+#include <QtCore/QDateTime>
 #include <QtCore/QDebug>
 
 #include <QtOrganizer/QOrganizerAbstractRequest>
@@ -30,29 +33,115 @@
 using namespace QtOrganizer;
 
 ViewWatcher::ViewWatcher(const QOrganizerCollectionId &collectionId,
-                         QOrganizerEDSEngineData *data,
-                         EClient *client)
+                         QOrganizerEDSEngineData *data)
     : m_collectionId(collectionId),
       m_engineData(data),
-      m_eClient(E_CAL_CLIENT(client)),
+      m_cancellable(0),
+      m_eClient(0),
       m_eView(0),
       m_eventLoop(0)
 {
-    g_object_ref(m_eClient);
+    m_lastUsed.start();
+    connect(&m_window, SIGNAL(timeout()), SLOT(onWindowExpired()));
+
+    SourceRegistry *registry = m_engineData->m_sourceRegistry;
+    QByteArray sourceId = m_collectionId.localId();
+    if (registry->clientState(sourceId) == SourceRegistry::ClientConnected) {
+        EClient *client = registry->client(sourceId);
+        start(client);
+        g_object_unref(client);
+    } else {
+        // open the view as soon as the backend is ready
+        connect(registry, &SourceRegistry::clientReady,
+                this, &ViewWatcher::onClientReady);
+        registry->connectClient(sourceId);
+    }
+}
+
+ViewWatcher::~ViewWatcher()
+{
+    clear();
+}
+
+void ViewWatcher::start(EClient *client)
+{
+    disconnect(m_engineData->m_sourceRegistry, &SourceRegistry::clientReady,
+               this, &ViewWatcher::onClientReady);
+
+    m_eClient = E_CAL_CLIENT(g_object_ref(client));
+    openView();
+
+    if (m_engineData->m_watchWindow > 0) {
+        // move the window forward twice a day
+        m_window.setInterval(12 * 60 * 60 * 1000);
+        m_window.start();
+    }
+}
+
+void ViewWatcher::openView()
+{
     m_cancellable = g_cancellable_new();
     e_cal_client_get_view(m_eClient,
-                          QStringLiteral("#t").toUtf8().constData(), // match all,
+                          query().constData(),
                           m_cancellable,
                           (GAsyncReadyCallback) ViewWatcher::viewReady,
                           this);
-    wait();
-    m_dirty.setSingleShot(true);
-    connect(&m_dirty, SIGNAL(timeout()), SLOT(flush()));
 }
 
-ViewWatcher::~ViewWatcher()
+QByteArray ViewWatcher::query() const
 {
-    clear();
+    if (m_engineData->m_watchWindow <= 0) {
+        return QByteArrayLiteral("#t"); // match all
+    }
+
+    // only watch changes around the current date
+    QDateTime now = QDateTime::currentDateTime();
+    gchar *startDateStr = isodate_from_time_t(now.addDays(-m_engineData->m_watchWindow).toTime_t());
+    gchar *endDateStr = isodate_from_time_t(now.addDays(m_engineData->m_watchWindow).toTime_t());
+
+    QByteArray query = QString("(occur-in-time-range? "
+                               "(make-time \"%1\") (make-time \"%2\"))")
+            .arg(startDateStr)
+            .arg(endDateStr).toUtf8();
+
+    g_free(startDateStr);
+    g_free(endDateStr);
+
+    return query;
+}
+
+void ViewWatcher::onWindowExpired()
+{
+    // still opening the previous view
+    if (m_cancellable || !m_eClient) {
+        return;
+    }
+
+    if (m_eView) {
+        GError *gErr = 0;
+        e_cal_client_view_stop(m_eView, &gErr);
+        if (gErr) {
+            qWarning() << "Fail to stop view" << gErr->message;
+            g_error_free(gErr);
+        }
+        g_clear_object(&m_eView);
+    }
+    openView();
+}
+
+void ViewWatcher::onClientReady(const QByteArray &sourceId)
+{
+    if (m_eClient || (sourceId != m_collectionId.localId())) {
+        return;
+    }
+
+    // in case of failure keep listening, the next request will try again
+    SourceRegistry *registry = m_engineData->m_sourceRegistry;
+    if (registry->clientState(sourceId) == SourceRegistry::ClientConnected) {
+        EClient *client = registry->client(sourceId);
+        start(client);
+        g_object_unref(client);
+    }
 }
 
 void ViewWatcher::viewReady(GObject *sourceObject, GAsyncResult *res, ViewWatcher *self)
@@ -84,6 +173,22 @@ void ViewWatcher::viewReady(GObject *sourceObject, GAsyncResult *res, ViewWatche
                          "objects-modified",
                          (GCallback) ViewWatcher::onObjectsModified,
                          self);
+        if (self->m_engineData->m_watchIdsOnly) {
+            // the ids are enough to notify about changes
+            GSList *fields = 0;
+            fields = g_slist_append(fields, (gpointer) "UID");
+            fields = g_slist_append(fields, (gpointer) "RECURRENCE-ID");
+            fields = g_slist_append(fields, (gpointer) "LAST-MODIFIED");
+            e_cal_client_view_set_fields_of_interest(view, fields, &gError);
+            g_slist_free(fields);
+            if (gError) {
+                qWarning() << "Fail to set view fields of interest ("
+                           << self->m_collectionId << "):"
+                           << gError->message;
+                g_error_free(gError);
+                gError = 0;
+            }
+        }
         e_cal_client_view_set_flags(view, E_CAL_CLIENT_VIEW_FLAGS_NONE, NULL);
         e_cal_client_view_start(view, &gError);
         if (gError) {
@@ -92,6 +197,7 @@ void ViewWatcher::viewReady(GObject *sourceObject, GAsyncResult *res, ViewWatche
                        << gError->message;
             g_error_free(gError);
             gError = 0;
+            g_clear_object(&self->m_eView);
         }
     }
     g_clear_object(&self->m_cancellable);
@@ -102,6 +208,10 @@ void ViewWatcher::viewReady(GObject *sourceObject, GAsyncResult *res, ViewWatche
 
 void ViewWatcher::clear()
 {
+    m_window.stop();
+    m_fingerprints.clear();
+    // nobody would tell about the changes from now on
+    m_engineData->m_instanceCache->clear(m_collectionId.localId());
     if (m_cancellable) {
         g_cancellable_cancel(m_cancellable);
         wait();
@@ -125,6 +235,17 @@ void ViewWatcher::clear()
 
 void ViewWatcher::wait()
 {
+    if (!m_eClient) {
+        // the caller needs the view now, do not wait for the backend
+        EClient *client = m_engineData->m_sourceRegistry->client(m_collectionId.localId());
+        if (client) {
+            if (!m_eClient) {
+                start(client);
+            }
+            g_object_unref(client);
+        }
+    }
+
     if (m_cancellable) {
         QEventLoop eventLoop;
         m_eventLoop = &eventLoop;
@@ -133,6 +254,172 @@ void ViewWatcher::wait()
     }
 }
 
+void ViewWatcher::touch()
+{
+    m_lastUsed.start();
+}
+
+qint64 ViewWatcher::idleTime() const
+{
+    return m_lastUsed.elapsed();
+}
+
+bool ViewWatcher::isRunning() const
+{
+    return (m_eView != 0);
+}
+
+QOrganizerItemId ViewWatcher::itemId(const QByteArray &uid, const QByteArray &rid) const
+{
+    // keep in sync with QOrganizerEDSEngine::parseId
+    QByteArray iId(uid);
+    if (!rid.isEmpty()) {
+        iId += "#" + rid;
+    }
+
+    QByteArray itemGuid =
+        iId.contains(':') ? iId.mid(iId.lastIndexOf(':') + 1) : iId;
+    return QOrganizerEDSEngine::idFromEds(m_collectionId, itemGuid);
+}
+
+QByteArray ViewWatcher::componentRid(icalcomponent *comp)
+{
+    icalproperty *prop = icalcomponent_get_first_property(comp, ICAL_RECURRENCEID_PROPERTY);
+    if (prop) {
+        struct icaltimetype rid = icalproperty_get_recurrenceid(prop);
+        if (!icaltime_is_null_time(rid)) {
+            return QByteArray(icaltime_as_ical_string(rid));
+        }
+    }
+    return QByteArray();
+}
+
+ItemFingerprint ViewWatcher::fingerprint(icalcomponent *comp)
+{
+    ItemFingerprint result;
+
+    QOrganizerItemDetail::DetailType timeType;
+    switch (icalcomponent_isa(comp)) {
+    case ICAL_VTODO_COMPONENT:
+        timeType = QOrganizerItemDetail::TypeTodoTime;
+        break;
+    case ICAL_VJOURNAL_COMPONENT:
+        timeType = QOrganizerItemDetail::TypeJournalTime;
+        break;
+    default:
+        timeType = QOrganizerItemDetail::TypeEventTime;
+        break;
+    }
+
+    for (icalproperty *prop = icalcomponent_get_first_property(comp, ICAL_ANY_PROPERTY);
+         prop;
+         prop = icalcomponent_get_next_property(comp, ICAL_ANY_PROPERTY)) {
+        QOrganizerItemDetail::DetailType type;
+        switch (icalproperty_isa(prop)) {
+        case ICAL_UID_PROPERTY:
+        case ICAL_RECURRENCEID_PROPERTY:
+        case ICAL_DTSTAMP_PROPERTY:
+        case ICAL_LASTMODIFIED_PROPERTY:
+        case ICAL_SEQUENCE_PROPERTY:
+        case ICAL_CREATED_PROPERTY:
+            // bookkeeping, updated on every save
+            continue;
+        case ICAL_DTSTART_PROPERTY:
+        case ICAL_DTEND_PROPERTY:
+        case ICAL_DUE_PROPERTY:
+        case ICAL_DURATION_PROPERTY:
+            type = timeType;
+            break;
+        case ICAL_SUMMARY_PROPERTY:
+            type = QOrganizerItemDetail::TypeDisplayLabel;
+            break;
+        case ICAL_DESCRIPTION_PROPERTY:
+            type = QOrganizerItemDetail::TypeDescription;
+            break;
+        case ICAL_COMMENT_PROPERTY:
+            type = QOrganizerItemDetail::TypeComment;
+            break;
+        case ICAL_CATEGORIES_PROPERTY:
+            type = QOrganizerItemDetail::TypeTag;
+            break;
+        case ICAL_RRULE_PROPERTY:
+        case ICAL_RDATE_PROPERTY:
+        case ICAL_EXRULE_PROPERTY:
+        case ICAL_EXDATE_PROPERTY:
+            type = QOrganizerItemDetail::TypeRecurrence;
+            break;
+        case ICAL_PRIORITY_PROPERTY:
+            type = QOrganizerItemDetail::TypePriority;
+            break;
+        case ICAL_LOCATION_PROPERTY:
+            type = QOrganizerItemDetail::TypeLocation;
+            break;
+        case ICAL_PERCENTCOMPLETE_PROPERTY:
+        case ICAL_STATUS_PROPERTY:
+        case ICAL_COMPLETED_PROPERTY:
+            type = QOrganizerItemDetail::TypeTodoProgress;
+            break;
+        case ICAL_ATTENDEE_PROPERTY:
+            type = QOrganizerItemDetail::TypeEventAttendee;
+            break;
+        case ICAL_CLASS_PROPERTY:
+            type = QOrganizerItemDetail::TypeClassification;
+            break;
+        case ICAL_X_PROPERTY:
+            type = QOrganizerItemDetail::TypeExtendedDetail;
+            break;
+        default:
+            // not mapped to a single detail
+            type = QOrganizerItemDetail::TypeUndefined;
+            break;
+        }
+
+        const char *data = icalproperty_as_ical_string(prop);
+        uint &hash = result[type];
+        hash = 31 * hash + qHash(QByteArray::fromRawData(data, strlen(data)));
+    }
+
+    for (icalcomponent *alarm = icalcomponent_get_first_component(comp, ICAL_VALARM_COMPONENT);
+         alarm;
+         alarm = icalcomponent_get_next_component(comp, ICAL_VALARM_COMPONENT)) {
+        const char *data = icalcomponent_as_ical_string(alarm);
+        uint &hash = result[QOrganizerItemDetail::TypeReminder];
+        hash = 31 * hash + qHash(QByteArray::fromRawData(data, strlen(data)));
+    }
+
+    return result;
+}
+
+QList<QOrganizerItemDetail::DetailType> ViewWatcher::changedDetails(const ItemFingerprint &before,
+                                                                   const ItemFingerprint &after)
+{
+    QList<QOrganizerItemDetail::DetailType> result;
+
+    QList<QOrganizerItemDetail::DetailType> types = before.keys();
+    Q_FOREACH(QOrganizerItemDetail::DetailType type, after.keys()) {
+        if (!before.contains(type)) {
+            types << type;
+        }
+    }
+    Q_FOREACH(QOrganizerItemDetail::DetailType type, types) {
+        if (before.value(type) == after.value(type)) {
+            continue;
+        }
+
+        if (type == QOrganizerItemDetail::TypeUndefined) {
+            // an empty list means anything could have changed
+            return QList<QOrganizerItemDetail::DetailType>();
+        } else if (type == QOrganizerItemDetail::TypeReminder) {
+            result << QOrganizerItemDetail::TypeReminder
+                   << QOrganizerItemDetail::TypeAudibleReminder
+                   << QOrganizerItemDetail::TypeVisualReminder;
+        } else {
+            result << type;
+        }
+    }
+    return result;
+}
+
 QList<QOrganizerItemId> ViewWatcher::parseItemIds(GSList *objects)
 {
     QList<QOrganizerItemId> result;
@@ -147,21 +434,51 @@ QList<QOrganizerItemId> ViewWatcher::parseItemIds(GSList *objects)
             qWarning() << "Fail to parse component ID";
         }
 
-        QOrganizerItemId itemId = QOrganizerEDSEngine::idFromEds(m_collectionId, uid);
-        result << itemId;
+        result << itemId(QByteArray(uid), componentRid(icalcomp));
     }
     return result;
 }
 
-void ViewWatcher::notify()
+QList<QOrganizerItemId> ViewWatcher::diffItems(GSList *objects)
 {
-    m_dirty.start(500);
+    QList<QOrganizerItemId> unknownItems;
+
+    for (GSList *l = objects; l; l = l->next) {
+        icalcomponent *icalcomp = static_cast<icalcomponent*>(l->data);
+        icalproperty *prop = icalcomponent_get_first_property(icalcomp, ICAL_UID_PROPERTY);
+        if (!prop) {
+            qWarning() << "Fail to parse component ID";
+            continue;
+        }
+
+        QByteArray uid(icalproperty_get_uid(prop));
+        QByteArray rid(componentRid(icalcomp));
+        ItemFingerprint current = fingerprint(icalcomp);
+
+        QHash<QByteArray, ItemFingerprint> &known = m_fingerprints[uid];
+        QHash<QByteArray, ItemFingerprint>::iterator i = known.find(rid);
+        if (i == known.end()) {
+            known.insert(rid, current);
+            unknownItems << itemId(uid, rid);
+        } else if (*i != current) {
+            QList<QOrganizerItemDetail::DetailType> types = changedDetails(*i, current);
+            *i = current;
+            m_engineData->notifyItemsChanged(QList<QOrganizerItemId>() << itemId(uid, rid),
+                                             types);
+        }
+        // else only the bookkeeping properties changed
+    }
+
+    return unknownItems;
 }
 
-void ViewWatcher::flush()
+void ViewWatcher::invalidateInstances(GSList *objects)
 {
-    m_engineData->emitSharedSignals(&m_changeSet);
-    m_changeSet.clearAll();
+    InstanceCache *cache = m_engineData->m_instanceCache;
+    QByteArray sourceId = m_collectionId.localId();
+    for (GSList *l = objects; l; l = l->next) {
+        cache->invalidate(sourceId, static_cast<icalcomponent*>(l->data));
+    }
 }
 
 void ViewWatcher::onObjectsAdded(ECalClientView *view,
@@ -169,8 +486,18 @@ void ViewWatcher::onObjectsAdded(ECalClientView *view,
                                  ViewWatcher *self)
 {
     Q_UNUSED(view);
-    self->m_changeSet.insertAddedItems(self->parseItemIds(objects));
-    self->notify();
+    self->invalidateInstances(objects);
+
+    if (self->m_engineData->m_watchIdsOnly) {
+        self->m_engineData->notifyItemsAdded(self->parseItemIds(objects));
+        return;
+    }
+
+    // items reported again after the view was reopened are not new
+    QList<QOrganizerItemId> itemIds = self->diffItems(objects);
+    if (!itemIds.isEmpty()) {
+        self->m_engineData->notifyItemsAdded(itemIds);
+    }
 }
 
 void ViewWatcher::onObjectsRemoved(ECalClientView *view,
@@ -179,12 +506,28 @@ void ViewWatcher::onObjectsRemoved(ECalClientView *view,
 {
     Q_UNUSED(view);
 
+    QList<QOrganizerItemId> itemIds;
     for (GSList *l = objects; l; l = l->next) {
         ECalComponentId *id = static_cast<ECalComponentId*>(l->data);
-        QOrganizerItemId itemId = QOrganizerEDSEngine::idFromEds(self->m_collectionId, id->uid);
-        self->m_changeSet.insertRemovedItem(itemId);
+        QByteArray uid(id->uid);
+        QByteArray rid(id->rid);
+        self->m_engineData->m_instanceCache->invalidate(self->m_collectionId.localId(), uid);
+        if (rid.isEmpty()) {
+            // the whole series is gone
+            self->m_fingerprints.remove(uid);
+        } else {
+            QHash<QByteArray, QHash<QByteArray, ItemFingerprint> >::iterator i =
+                self->m_fingerprints.find(uid);
+            if (i != self->m_fingerprints.end()) {
+                i->remove(rid);
+                if (i->isEmpty()) {
+                    self->m_fingerprints.erase(i);
+                }
+            }
+        }
+        itemIds << self->itemId(uid, rid);
     }
-    self->notify();
+    self->m_engineData->notifyItemsRemoved(itemIds);
 }
 
 void ViewWatcher::onObjectsModified(ECalClientView *view,
@@ -192,8 +535,18 @@ void ViewWatcher::onObjectsModified(ECalClientView *view,
                                     ViewWatcher *self)
 {
     Q_UNUSED(view);
+    self->invalidateInstances(objects);
 
-    self->m_changeSet.insertChangedItems(self->parseItemIds(objects),
-                                         QList<QOrganizerItemDetail::DetailType>());
-    self->notify();
+    if (self->m_engineData->m_watchIdsOnly) {
+        // nothing to compare with, report the items as fully changed
+        self->m_engineData->notifyItemsChanged(self->parseItemIds(objects),
+                                               QList<QOrganizerItemDetail::DetailType>());
+        return;
+    }
+
+    QList<QOrganizerItemId> itemIds = self->diffItems(objects);
+    if (!itemIds.isEmpty()) {
+        self->m_engineData->notifyItemsChanged(itemIds,
+                                               QList<QOrganizerItemDetail::DetailType>());
+    }
 }
@@ -21,28 +21,38 @@
 
 #include "qorganizer-eds-engine.h"
 
+#include <QtCore/QHash>
 #include <QtCore/QList>
+#include <QtCore/QMap>
 #include <QtCore/QObject>
 #include <QtCore/QEventLoop>
+#include <QtCore/QElapsedTimer>
 #include <QtCore/QTimer>
 
 #include <libecal/libecal.h>
 
 class QOrganizerEDSEngineData;
 
+// hash of the iCal properties that feed each item detail
+typedef QMap<QtOrganizer::QOrganizerItemDetail::DetailType, uint> ItemFingerprint;
+
 class ViewWatcher : public QObject
 {
     Q_OBJECT
 public:
     ViewWatcher(const QOrganizerCollectionId &collectionId,
-                QOrganizerEDSEngineData *data,
-                EClient *client);
+                QOrganizerEDSEngineData *data);
     virtual ~ViewWatcher();
     void clear();
     void wait();
+    void touch();
+    qint64 idleTime() const;
+    // true once the view reports the changes of the collection
+    bool isRunning() const;
 
 private Q_SLOTS:
-    void flush();
+    void onClientReady(const QByteArray &sourceId);
+    void onWindowExpired();
 
 private:
     QOrganizerCollectionId m_collectionId;
@@ -51,11 +61,23 @@ private:
     ECalClient *m_eClient;
     ECalClientView *m_eView;
     QEventLoop *m_eventLoop;
-    QOrganizerItemChangeSet m_changeSet;
-    QTimer m_dirty;
+    QElapsedTimer m_lastUsed;
+    QTimer m_window;
+    // uid -> recurrence id -> last known fingerprint
+    QHash<QByteArray, QHash<QByteArray, ItemFingerprint> > m_fingerprints;
 
+    void start(EClient *client);
+    void openView();
+    QByteArray query() const;
+    QtOrganizer::QOrganizerItemId itemId(const QByteArray &uid, const QByteArray &rid) const;
     QList<QtOrganizer::QOrganizerItemId> parseItemIds(GSList *objects);
-    void notify();
+    QList<QtOrganizer::QOrganizerItemId> diffItems(GSList *objects);
+    void invalidateInstances(GSList *objects);
+
+    static QByteArray componentRid(icalcomponent *comp);
+    static ItemFingerprint fingerprint(icalcomponent *comp);
+    static QList<QtOrganizer::QOrganizerItemDetail::DetailType> changedDetails(const ItemFingerprint &before,
+                                                                              const ItemFingerprint &after);
 
 
     static void clientConnected(GObject *sourceObject, GAsyncResult *res, ViewWatcher *self);
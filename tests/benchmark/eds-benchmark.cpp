@@ -0,0 +1,154 @@
+/*
+ * Copyright 2015 Canonical Ltd.
+ *
+ * This file is part of qtorganizer5-eds.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#define private public
+#include "qorganizer-eds-engine.h"
+#include "qorganizer-eds-enginedata.h"
+#include "qorganizer-eds-instancecache.h"
+#include "qorganizer-eds-requestdata.h"
+
+#include "eds-benchmark.h"
+
+#include <QtTest>
+
+using namespace QtOrganizer;
+
+EDSBenchmark::EDSBenchmark()
+    : m_engine(0)
+{
+}
+
+EDSBenchmark::~EDSBenchmark()
+{
+}
+
+void EDSBenchmark::initTestCase()
+{
+    EDSBaseTest::initTestCase();
+    m_engine = QOrganizerEDSEngine::createEDSEngine(QMap<QString, QString>());
+}
+
+void EDSBenchmark::cleanupTestCase()
+{
+    removeCollections();
+    delete m_engine;
+    m_engine = 0;
+    EDSBaseTest::cleanup();
+}
+
+bool EDSBenchmark::createCollections(int count)
+{
+    for (int i = 0; i < count; i++) {
+        QOrganizerCollection collection;
+        QOrganizerManager::Error error;
+        collection.setMetaData(QOrganizerCollection::KeyName, uniqueCollectionName());
+        if (!m_engine->saveCollection(&collection, &error)) {
+            qWarning() << "Fail to create benchmark collection" << error;
+            return false;
+        }
+        m_collections << collection;
+    }
+    return true;
+}
+
+void EDSBenchmark::removeCollections()
+{
+    Q_FOREACH(const QOrganizerCollection &collection, m_collections) {
+        QOrganizerManager::Error error;
+        m_engine->removeCollection(collection.id(), &error);
+    }
+    m_collections.clear();
+    QTRY_COMPARE(RequestData::instanceCount(), 0);
+}
+
+QList<QOrganizerItem> EDSBenchmark::generateEvents(const QOrganizerCollection &collection,
+                                                   int count,
+                                                   bool recurring) const
+{
+    static const QString displayLabelValue = QStringLiteral("Benchmark event %1");
+    static const QString descriptionValue = QStringLiteral("Benchmark event description %1");
+
+    // EDS does not store msecs
+    QDateTime start(QDate::currentDate(), QTime(8, 0, 0));
+    QList<QOrganizerItem> events;
+    events.reserve(count);
+    for (int i = 0; i < count; i++) {
+        QOrganizerEvent ev;
+        ev.setCollectionId(collection.id());
+        ev.setStartDateTime(start.addSecs(i * 60 * 60 * 5));
+        ev.setEndDateTime(ev.startDateTime().addSecs(60 * 30));
+        ev.setDisplayLabel(displayLabelValue.arg(i));
+        ev.setDescription(descriptionValue.arg(i));
+
+        if (recurring) {
+            QOrganizerRecurrenceRule rule;
+            rule.setFrequency(QOrganizerRecurrenceRule::Daily);
+            rule.setLimit(ev.startDateTime().date().addDays(30));
+            ev.setRecurrenceRule(rule);
+        }
+        events << ev;
+    }
+    return events;
+}
+
+QList<QOrganizerItemId> EDSBenchmark::saveEvents(QList<QOrganizerItem> *events)
+{
+    QOrganizerManager::Error error;
+    QMap<int, QOrganizerManager::Error> errorMap;
+    QList<QOrganizerItemId> ids;
+
+    if (!m_engine->saveItems(events, QList<QOrganizerItemDetail::DetailType>(), &errorMap, &error)) {
+        qWarning() << "Fail to save benchmark events" << error << errorMap;
+        return ids;
+    }
+
+    ids.reserve(events->size());
+    Q_FOREACH(const QOrganizerItem &item, *events) {
+        ids << item.id();
+    }
+    return ids;
+}
+
+QList<QOrganizerItemId> EDSBenchmark::populate(int events, bool recurring)
+{
+    QList<QOrganizerItemId> ids;
+    Q_FOREACH(const QOrganizerCollection &collection, m_collections) {
+        QList<QOrganizerItem> items = generateEvents(collection, events, recurring);
+        ids += saveEvents(&items);
+    }
+    return ids;
+}
+
+void EDSBenchmark::dropCaches()
+{
+    m_engine->d->invalidateFetchResults();
+    Q_FOREACH(const QOrganizerCollection &collection, m_collections) {
+        m_engine->d->m_instanceCache->clear(collection.id().localId());
+    }
+}
+
+QDateTime EDSBenchmark::rangeStart() const
+{
+    return QDateTime(QDate::currentDate(), QTime(0, 0, 0));
+}
+
+QDateTime EDSBenchmark::rangeEnd() const
+{
+    return rangeStart().addDays(31);
+}
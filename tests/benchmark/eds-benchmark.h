@@ -0,0 +1,68 @@
+/*
+ * Copyright 2015 Canonical Ltd.
+ *
+ * This file is part of qtorganizer5-eds.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __EDS_BENCHMARK__
+#define __EDS_BENCHMARK__
+
+#include "eds-base-test.h"
+
+#include <QtCore>
+#include <QtOrganizer>
+
+class QOrganizerEDSEngine;
+
+// Fixtures shared by the benchmarks: an engine and a set of collections
+// filled with generated events
+class EDSBenchmark : public EDSBaseTest
+{
+public:
+    EDSBenchmark();
+    ~EDSBenchmark();
+
+protected:
+    QOrganizerEDSEngine *m_engine;
+    QList<QtOrganizer::QOrganizerCollection> m_collections;
+
+    virtual void initTestCase();
+    virtual void cleanupTestCase();
+
+    // creates "count" collections and appends them to m_collections
+    bool createCollections(int count);
+    void removeCollections();
+
+    // "count" events starting today, one every few hours. Recurring events
+    // repeat daily for a month.
+    QList<QtOrganizer::QOrganizerItem> generateEvents(const QtOrganizer::QOrganizerCollection &collection,
+                                                      int count,
+                                                      bool recurring) const;
+    // saves the events and returns their ids
+    QList<QtOrganizer::QOrganizerItemId> saveEvents(QList<QtOrganizer::QOrganizerItem> *events);
+    // creates "events" events in each of m_collections
+    QList<QtOrganizer::QOrganizerItemId> populate(int events, bool recurring);
+
+    // forgets the fetch results and listed instances kept by the engine, so
+    // the next fetch goes to EDS again
+    void dropCaches();
+
+    // the window used by the range fetches
+    QDateTime rangeStart() const;
+    QDateTime rangeEnd() const;
+};
+
+#endif
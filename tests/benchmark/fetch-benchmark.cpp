@@ -0,0 +1,191 @@
+/*
+ * Copyright 2015 Canonical Ltd.
+ *
+ * This file is part of qtorganizer5-eds.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <QObject>
+#include <QtTest>
+#include <QDebug>
+
+#include <QtOrganizer>
+
+#include "qorganizer-eds-engine.h"
+#include "eds-benchmark.h"
+
+using namespace QtOrganizer;
+
+class FetchBenchmark : public QObject, public EDSBenchmark
+{
+    Q_OBJECT
+private:
+    QList<QOrganizerItemId> m_ids;
+    QString m_dataSet;
+
+    // the rows of a data set share their collections, only rebuild them when
+    // the set changes
+    bool prepare(int calendars, int events, bool recurring)
+    {
+        QString dataSet = QString("%1x%2 %3").arg(calendars).arg(events).arg(recurring);
+        if (dataSet == m_dataSet) {
+            return true;
+        }
+
+        removeCollections();
+        m_dataSet.clear();
+        if (!createCollections(calendars)) {
+            return false;
+        }
+        m_ids = populate(events, recurring);
+        if (m_ids.size() != calendars * events) {
+            return false;
+        }
+        m_dataSet = dataSet;
+        return true;
+    }
+
+    void fetchData()
+    {
+        QTest::addColumn<int>("calendars");
+        QTest::addColumn<int>("events");
+        QTest::addColumn<bool>("recurring");
+        QTest::addColumn<bool>("cached");
+
+        QList<int> calendars = QList<int>() << 1 << 5;
+        QList<int> events = QList<int>() << 50 << 200;
+        Q_FOREACH(int n, calendars) {
+            Q_FOREACH(int m, events) {
+                Q_FOREACH(bool recurring, QList<bool>() << false << true) {
+                    Q_FOREACH(bool cached, QList<bool>() << false << true) {
+                        QTest::newRow(QString("%1x%2%3%4").arg(n).arg(m)
+                                      .arg(recurring ? " recurring" : "")
+                                      .arg(cached ? " cached" : "").toUtf8().constData())
+                            << n << m << recurring << cached;
+                    }
+                }
+            }
+        }
+    }
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        EDSBenchmark::initTestCase();
+    }
+
+    void cleanupTestCase()
+    {
+        m_ids.clear();
+        EDSBenchmark::cleanupTestCase();
+    }
+
+    void benchmarkFetchRange_data()
+    {
+        fetchData();
+    }
+
+    // range fetch over a month, expanding the recurrences
+    void benchmarkFetchRange()
+    {
+        QFETCH(int, calendars);
+        QFETCH(int, events);
+        QFETCH(bool, recurring);
+        QFETCH(bool, cached);
+
+        QVERIFY(prepare(calendars, events, recurring));
+
+        QOrganizerItemFilter filter;
+        QOrganizerItemFetchHint hint;
+        QList<QOrganizerItemSortOrder> sort;
+        QOrganizerManager::Error error = QOrganizerManager::NoError;
+        QList<QOrganizerItem> items;
+
+        QBENCHMARK {
+            if (!cached) {
+                dropCaches();
+            }
+            items = m_engine->items(filter, rangeStart(), rangeEnd(), -1, sort, hint, &error);
+        }
+        QCOMPARE(error, QOrganizerManager::NoError);
+        QVERIFY(items.size() >= m_ids.size());
+    }
+
+    void benchmarkFetchAll_data()
+    {
+        fetchData();
+    }
+
+    // fetch without a range, recurring events are not expanded
+    void benchmarkFetchAll()
+    {
+        QFETCH(int, calendars);
+        QFETCH(int, events);
+        QFETCH(bool, recurring);
+        QFETCH(bool, cached);
+
+        QVERIFY(prepare(calendars, events, recurring));
+
+        QOrganizerItemFilter filter;
+        QOrganizerItemFetchHint hint;
+        QList<QOrganizerItemSortOrder> sort;
+        QOrganizerManager::Error error = QOrganizerManager::NoError;
+        QList<QOrganizerItem> items;
+
+        QBENCHMARK {
+            if (!cached) {
+                dropCaches();
+            }
+            items = m_engine->items(filter, QDateTime(), QDateTime(), -1, sort, hint, &error);
+        }
+        QCOMPARE(error, QOrganizerManager::NoError);
+        QCOMPARE(items.size(), m_ids.size());
+    }
+
+    void benchmarkFetchById_data()
+    {
+        QTest::addColumn<int>("calendars");
+        QTest::addColumn<int>("events");
+
+        QTest::newRow("1x50") << 1 << 50;
+        QTest::newRow("1x200") << 1 << 200;
+        QTest::newRow("5x50") << 5 << 50;
+        QTest::newRow("5x200") << 5 << 200;
+    }
+
+    void benchmarkFetchById()
+    {
+        QFETCH(int, calendars);
+        QFETCH(int, events);
+
+        QVERIFY(prepare(calendars, events, false));
+
+        QOrganizerItemFetchHint hint;
+        QMap<int, QOrganizerManager::Error> errorMap;
+        QOrganizerManager::Error error = QOrganizerManager::NoError;
+        QList<QOrganizerItem> items;
+
+        QBENCHMARK {
+            items = m_engine->items(m_ids, hint, &errorMap, &error);
+        }
+        QCOMPARE(error, QOrganizerManager::NoError);
+        QVERIFY(errorMap.isEmpty());
+        QCOMPARE(items.size(), m_ids.size());
+    }
+};
+
+QTEST_MAIN(FetchBenchmark)
+
+#include "fetch-benchmark.moc"
@@ -0,0 +1,309 @@
+/*
+ * Copyright 2015 Canonical Ltd.
+ *
+ * This file is part of qtorganizer5-eds.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// the parse functions are private, but static and free of EDS
+#define private public
+#include "qorganizer-eds-engine.h"
+#undef private
+
+#include <QObject>
+#include <QtTest>
+#include <QDebug>
+
+#include <QtOrganizer>
+
+#include <libecal/libecal.h>
+
+using namespace QtOrganizer;
+
+// components in each generated corpus
+#define CORPUS_SIZE             1000
+// an .ics file to benchmark together with the generated corpora
+#define CORPUS_FILE_VARIABLE    "QORGANIZER_EDS_BENCHMARK_CORPUS"
+
+// Benchmarks the conversion between icalcomponents and QOrganizerItems over
+// generated calendars. Nothing here talks to evolution-data-server, so it runs
+// on any machine.
+class ParseBenchmark : public QObject
+{
+    Q_OBJECT
+private:
+    QOrganizerCollectionId m_collectionId;
+
+    static QByteArray icalTime(const QDateTime &dt)
+    {
+        return dt.toString(QStringLiteral("yyyyMMdd'T'hhmmss")).toLatin1();
+    }
+
+    static QByteArray eventHeader(int index, const QDateTime &start)
+    {
+        QByteArray uid = QByteArray("20150408T215243Z-19265-1000-5926-") + QByteArray::number(index) + "@benchmark";
+        return QByteArray("BEGIN:VEVENT\r\n"
+                          "UID:") + uid + "\r\n"
+               "DTSTAMP:20150408T214536Z\r\n"
+               "SEQUENCE:1\r\n"
+               "SUMMARY:Benchmark event " + QByteArray::number(index) + "\r\n"
+               "DESCRIPTION:Generated event number " + QByteArray::number(index) + "\r\n"
+               "CATEGORIES:work,benchmark\r\n"
+               "CREATED:" + icalTime(start) + "Z\r\n"
+               "LAST-MODIFIED:" + icalTime(start) + "Z\r\n";
+    }
+
+    static QByteArray simpleEvent(int index, const QDateTime &start)
+    {
+        return eventHeader(index, start) +
+               "DTSTART:" + icalTime(start) + "Z\r\n"
+               "DTEND:" + icalTime(start.addSecs(30 * 60)) + "Z\r\n"
+               "LOCATION:Room " + QByteArray::number(index % 20) + "\r\n"
+               "END:VEVENT\r\n";
+    }
+
+    static QByteArray recurringEvent(int index, const QDateTime &start)
+    {
+        return eventHeader(index, start) +
+               "DTSTART;TZID=/freeassociation.sourceforge.net/Tzfile/America/Recife:" + icalTime(start) + "\r\n"
+               "DTEND;TZID=/freeassociation.sourceforge.net/Tzfile/America/Recife:" + icalTime(start.addSecs(60 * 60)) + "\r\n"
+               "RRULE:FREQ=WEEKLY;BYDAY=MO,WE,FR;UNTIL=" + icalTime(start.addDays(180)) + "Z\r\n"
+               "EXDATE;VALUE=DATE:" + start.addDays(7).toString(QStringLiteral("yyyyMMdd")).toLatin1() + "\r\n"
+               "EXDATE;VALUE=DATE:" + start.addDays(14).toString(QStringLiteral("yyyyMMdd")).toLatin1() + "\r\n"
+               "RDATE;VALUE=DATE:" + start.addDays(200).toString(QStringLiteral("yyyyMMdd")).toLatin1() + "\r\n"
+               "END:VEVENT\r\n";
+    }
+
+    static QByteArray attendeeEvent(int index, const QDateTime &start)
+    {
+        static const char *status[] = { "ACCEPTED", "DECLINED", "TENTATIVE", "NEEDS-ACTION" };
+        QByteArray event = eventHeader(index, start) +
+               "DTSTART:" + icalTime(start) + "Z\r\n"
+               "DTEND:" + icalTime(start.addSecs(30 * 60)) + "Z\r\n"
+               "ORGANIZER;CN=Organizer:mailto:organizer@example.com\r\n";
+        for (int i = 0; i < 20; i++) {
+            QByteArray number = QByteArray::number(i);
+            event += "ATTENDEE;CN=Attendee " + number +
+                     ";ROLE=REQ-PARTICIPANT;PARTSTAT=" + status[i % 4] +
+                     ";RSVP=TRUE:mailto:attendee" + number + "@example.com\r\n";
+        }
+        return event + "END:VEVENT\r\n";
+    }
+
+    static QByteArray alarmEvent(int index, const QDateTime &start)
+    {
+        QByteArray event = eventHeader(index, start) +
+               "DTSTART:" + icalTime(start) + "Z\r\n"
+               "DTEND:" + icalTime(start.addSecs(30 * 60)) + "Z\r\n";
+        for (int i = 1; i <= 5; i++) {
+            QByteArray minutes = QByteArray::number(i * 5);
+            if (i % 2) {
+                event += "BEGIN:VALARM\r\n"
+                         "ACTION:DISPLAY\r\n"
+                         "TRIGGER;VALUE=DURATION;RELATED=START:-PT" + minutes + "M\r\n"
+                         "DESCRIPTION:Starts in " + minutes + " minutes\r\n"
+                         "END:VALARM\r\n";
+            } else {
+                event += "BEGIN:VALARM\r\n"
+                         "ACTION:AUDIO\r\n"
+                         "TRIGGER;VALUE=DURATION;RELATED=START:-PT" + minutes + "M\r\n"
+                         "REPEAT:3\r\n"
+                         "DURATION:PT1M\r\n"
+                         "ATTACH:file:///usr/share/sounds/alarm.ogg\r\n"
+                         "END:VALARM\r\n";
+            }
+        }
+        return event + "END:VEVENT\r\n";
+    }
+
+    static QByteArray timezoneEvent(int index, const QDateTime &start)
+    {
+        static const char *zones[] = {
+            "America/Recife",
+            "/freeassociation.sourceforge.net/Tzfile/Europe/Berlin",
+            "Asia/Tokyo",
+            "/freeassociation.sourceforge.net/Tzfile/America/New_York",
+            "Australia/Sydney",
+            "Europe/London"
+        };
+        QByteArray zone(zones[index % 6]);
+        return eventHeader(index, start) +
+               "DTSTART;TZID=" + zone + ":" + icalTime(start) + "\r\n"
+               "DTEND;TZID=" + zone + ":" + icalTime(start.addSecs(45 * 60)) + "\r\n"
+               "END:VEVENT\r\n";
+    }
+
+    static QByteArray generateCorpus(const QString &kind)
+    {
+        QDateTime start(QDate(2015, 4, 8), QTime(8, 0, 0));
+        QByteArray calendar("BEGIN:VCALENDAR\r\n"
+                            "VERSION:2.0\r\n"
+                            "PRODID:-//qtorganizer5-eds//parse-benchmark//EN\r\n");
+        for (int i = 0; i < CORPUS_SIZE; i++) {
+            QDateTime eventStart = start.addSecs(i * 60 * 60 * 3);
+            if (kind == QStringLiteral("simple")) {
+                calendar += simpleEvent(i, eventStart);
+            } else if (kind == QStringLiteral("recurring")) {
+                calendar += recurringEvent(i, eventStart);
+            } else if (kind == QStringLiteral("attendees")) {
+                calendar += attendeeEvent(i, eventStart);
+            } else if (kind == QStringLiteral("alarms")) {
+                calendar += alarmEvent(i, eventStart);
+            } else if (kind == QStringLiteral("timezones")) {
+                calendar += timezoneEvent(i, eventStart);
+            }
+        }
+        return calendar + "END:VCALENDAR\r\n";
+    }
+
+    static QByteArray loadCorpus(const QString &kind)
+    {
+        if (kind != QStringLiteral("file")) {
+            return generateCorpus(kind);
+        }
+
+        QFile file(QString::fromLocal8Bit(qgetenv(CORPUS_FILE_VARIABLE)));
+        if (!file.open(QIODevice::ReadOnly)) {
+            qWarning() << "Fail to open corpus" << file.fileName();
+            return QByteArray();
+        }
+        return file.readAll();
+    }
+
+    // the VEVENT, VTODO and VJOURNAL components of the calendar, as the
+    // backends hand them to parseEvents()
+    static GSList *icalComponents(const QByteArray &data)
+    {
+        icalcomponent *calendar = icalparser_parse_string(data.constData());
+        if (!calendar) {
+            return 0;
+        }
+
+        GSList *components = 0;
+        for (icalcomponent *comp = icalcomponent_get_first_component(calendar, ICAL_ANY_COMPONENT);
+             comp;
+             comp = icalcomponent_get_next_component(calendar, ICAL_ANY_COMPONENT)) {
+            icalcomponent_kind kind = icalcomponent_isa(comp);
+            if ((kind == ICAL_VEVENT_COMPONENT) ||
+                (kind == ICAL_VTODO_COMPONENT) ||
+                (kind == ICAL_VJOURNAL_COMPONENT)) {
+                components = g_slist_prepend(components, icalcomponent_new_clone(comp));
+            }
+        }
+        icalcomponent_free(calendar);
+        return g_slist_reverse(components);
+    }
+
+    void corpusData()
+    {
+        QTest::addColumn<QString>("kind");
+
+        QTest::newRow("simple") << QStringLiteral("simple");
+        QTest::newRow("recurring") << QStringLiteral("recurring");
+        QTest::newRow("attendees") << QStringLiteral("attendees");
+        QTest::newRow("alarms") << QStringLiteral("alarms");
+        QTest::newRow("timezones") << QStringLiteral("timezones");
+        if (!qgetenv(CORPUS_FILE_VARIABLE).isEmpty()) {
+            QTest::newRow("file") << QStringLiteral("file");
+        }
+    }
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        m_collectionId = QOrganizerCollectionId(QStringLiteral("qtorganizer:eds::"), QByteArray("benchmark"));
+    }
+
+    void benchmarkParseEvents_data()
+    {
+        corpusData();
+    }
+
+    // icalcomponent -> QOrganizerItem
+    void benchmarkParseEvents()
+    {
+        QFETCH(QString, kind);
+
+        GSList *components = icalComponents(loadCorpus(kind));
+        QVERIFY(components);
+        int count = g_slist_length(components);
+
+        ParsePlan plan;
+        QList<QOrganizerItem> items;
+        QBENCHMARK {
+            items = QOrganizerEDSEngine::parseEvents(m_collectionId, components, true, plan);
+        }
+        QCOMPARE(items.size(), count);
+
+        g_slist_free_full(components, (GDestroyNotify) icalcomponent_free);
+    }
+
+    void benchmarkParseEventsListView_data()
+    {
+        corpusData();
+    }
+
+    // the same conversion with the hint of a list view
+    void benchmarkParseEventsListView()
+    {
+        QFETCH(QString, kind);
+
+        GSList *components = icalComponents(loadCorpus(kind));
+        QVERIFY(components);
+        int count = g_slist_length(components);
+
+        QList<QOrganizerItemDetail::DetailType> detailsHint;
+        detailsHint << QOrganizerItemDetail::TypeDisplayLabel
+                    << QOrganizerItemDetail::TypeEventTime;
+        ParsePlan plan(detailsHint);
+        QList<QOrganizerItem> items;
+        QBENCHMARK {
+            items = QOrganizerEDSEngine::parseEvents(m_collectionId, components, true, plan);
+        }
+        QCOMPARE(items.size(), count);
+
+        g_slist_free_full(components, (GDestroyNotify) icalcomponent_free);
+    }
+
+    void benchmarkParseItems_data()
+    {
+        corpusData();
+    }
+
+    // QOrganizerItem -> icalcomponent, as done when saving
+    void benchmarkParseItems()
+    {
+        QFETCH(QString, kind);
+
+        GSList *components = icalComponents(loadCorpus(kind));
+        QVERIFY(components);
+        QList<QOrganizerItem> items = QOrganizerEDSEngine::parseEvents(m_collectionId, components, true, ParsePlan());
+        g_slist_free_full(components, (GDestroyNotify) icalcomponent_free);
+        QVERIFY(!items.isEmpty());
+
+        int count = 0;
+        QBENCHMARK {
+            bool hasRecurrence = false;
+            GSList *comps = QOrganizerEDSEngine::parseItems(0, items, &hasRecurrence);
+            count = g_slist_length(comps);
+            g_slist_free_full(comps, (GDestroyNotify) icalcomponent_free);
+        }
+        QCOMPARE(count, items.size());
+    }
+};
+
+QTEST_MAIN(ParseBenchmark)
+
+#include "parse-benchmark.moc"
@@ -0,0 +1,139 @@
+/*
+ * Copyright 2015 Canonical Ltd.
+ *
+ * This file is part of qtorganizer5-eds.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <QObject>
+#include <QtTest>
+#include <QDebug>
+
+#include <QtOrganizer>
+
+#include "qorganizer-eds-engine.h"
+#include "eds-benchmark.h"
+
+using namespace QtOrganizer;
+
+class SaveBenchmark : public QObject, public EDSBenchmark
+{
+    Q_OBJECT
+private:
+    void bulkData()
+    {
+        QTest::addColumn<int>("count");
+        QTest::addColumn<bool>("recurring");
+
+        QTest::newRow("50") << 50 << false;
+        QTest::newRow("200") << 200 << false;
+        QTest::newRow("1000") << 1000 << false;
+        QTest::newRow("200 recurring") << 200 << true;
+    }
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        EDSBenchmark::initTestCase();
+    }
+
+    void cleanupTestCase()
+    {
+        EDSBenchmark::cleanupTestCase();
+    }
+
+    void init()
+    {
+        QVERIFY(createCollections(1));
+    }
+
+    void cleanup()
+    {
+        removeCollections();
+    }
+
+    void benchmarkSave_data()
+    {
+        bulkData();
+    }
+
+    // a single save request with "count" new events
+    void benchmarkSave()
+    {
+        QFETCH(int, count);
+        QFETCH(bool, recurring);
+
+        QList<QOrganizerItem> events = generateEvents(m_collections.first(), count, recurring);
+        QList<QOrganizerItemId> ids;
+        QBENCHMARK_ONCE {
+            ids = saveEvents(&events);
+        }
+        QCOMPARE(ids.size(), count);
+    }
+
+    void benchmarkUpdate_data()
+    {
+        bulkData();
+    }
+
+    // a single save request changing "count" existing events
+    void benchmarkUpdate()
+    {
+        QFETCH(int, count);
+        QFETCH(bool, recurring);
+
+        QList<QOrganizerItem> events = generateEvents(m_collections.first(), count, recurring);
+        QCOMPARE(saveEvents(&events).size(), count);
+        for (int i = 0; i < events.size(); i++) {
+            events[i].setDisplayLabel(QStringLiteral("Updated benchmark event %1").arg(i));
+        }
+
+        QList<QOrganizerItemId> ids;
+        QBENCHMARK_ONCE {
+            ids = saveEvents(&events);
+        }
+        QCOMPARE(ids.size(), count);
+    }
+
+    void benchmarkRemove_data()
+    {
+        bulkData();
+    }
+
+    // a single remove request with "count" events
+    void benchmarkRemove()
+    {
+        QFETCH(int, count);
+        QFETCH(bool, recurring);
+
+        QList<QOrganizerItem> events = generateEvents(m_collections.first(), count, recurring);
+        QList<QOrganizerItemId> ids = saveEvents(&events);
+        QCOMPARE(ids.size(), count);
+
+        QMap<int, QOrganizerManager::Error> errorMap;
+        QOrganizerManager::Error error = QOrganizerManager::NoError;
+        bool removed = false;
+        QBENCHMARK_ONCE {
+            removed = m_engine->removeItems(ids, &errorMap, &error);
+        }
+        QVERIFY(removed);
+        QCOMPARE(error, QOrganizerManager::NoError);
+        QVERIFY(errorMap.isEmpty());
+    }
+};
+
+QTEST_MAIN(SaveBenchmark)
+
+#include "save-benchmark.moc"
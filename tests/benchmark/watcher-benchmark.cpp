@@ -0,0 +1,222 @@
+/*
+ * Copyright 2015 Canonical Ltd.
+ *
+ * This file is part of qtorganizer5-eds.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <QObject>
+#include <QtTest>
+#include <QDebug>
+
+#include <QtOrganizer>
+
+#include <libecal/libecal.h>
+
+#include "config.h"
+#include "qorganizer-eds-engine.h"
+#include "eds-benchmark.h"
+#include "gscopedpointer.h"
+
+using namespace QtOrganizer;
+
+// how long to wait for the engine to report the changes
+#define NOTIFICATION_TIMEOUT    (60 * 1000)
+
+// Changes are written with a separate EDS client, so the engine only learns
+// about them through its ViewWatcher. The benchmarks time from the write until
+// the engine reported every changed item.
+class WatcherBenchmark : public QObject, public EDSBenchmark
+{
+    Q_OBJECT
+private:
+    GScopedPointer<ESourceRegistry> m_registry;
+    GScopedPointer<EClient> m_client;
+    int m_notified;
+    bool m_reloaded;
+
+    GSList *generateComponents(int count) const
+    {
+        time_t start = QDateTime(QDate::currentDate(), QTime(8, 0, 0)).toTime_t();
+        GSList *comps = 0;
+        for (int i = 0; i < count; i++) {
+            icalcomponent *comp = icalcomponent_new(ICAL_VEVENT_COMPONENT);
+            icalcomponent_set_summary(comp, QString("Watched event %1").arg(i).toUtf8().constData());
+            icalcomponent_set_dtstart(comp, icaltime_from_timet_with_zone(start + i * 60 * 60 * 5, 0,
+                                                                          icaltimezone_get_utc_timezone()));
+            icalcomponent_set_dtend(comp, icaltime_from_timet_with_zone(start + i * 60 * 60 * 5 + 60 * 30, 0,
+                                                                        icaltimezone_get_utc_timezone()));
+            comps = g_slist_prepend(comps, comp);
+        }
+        return comps;
+    }
+
+    bool createObjects(int count, GSList **uids)
+    {
+        GError *error = 0;
+        GSList *comps = generateComponents(count);
+        e_cal_client_create_objects_sync(E_CAL_CLIENT(m_client.data()), comps, uids, 0, &error);
+        g_slist_free_full(comps, (GDestroyNotify) icalcomponent_free);
+        if (error) {
+            qWarning() << "Fail to create objects" << error->message;
+            g_error_free(error);
+            return false;
+        }
+        return true;
+    }
+
+    bool removeObjects(GSList *uids)
+    {
+        GSList *ids = 0;
+        for (GSList *l = uids; l; l = l->next) {
+            ECalComponentId *id = g_new0(ECalComponentId, 1);
+            id->uid = g_strdup(static_cast<const gchar*>(l->data));
+            ids = g_slist_prepend(ids, id);
+        }
+
+        GError *error = 0;
+        e_cal_client_remove_objects_sync(E_CAL_CLIENT(m_client.data()), ids, E_CAL_OBJ_MOD_THIS, 0, &error);
+        g_slist_free_full(ids, (GDestroyNotify) e_cal_component_free_id);
+        if (error) {
+            qWarning() << "Fail to remove objects" << error->message;
+            g_error_free(error);
+            return false;
+        }
+        return true;
+    }
+
+    bool waitForNotifications(int count)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        while ((m_notified < count) && !m_reloaded) {
+            if (timer.elapsed() > NOTIFICATION_TIMEOUT) {
+                return false;
+            }
+            QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents, 10);
+        }
+        return true;
+    }
+
+    void resetNotifications()
+    {
+        m_notified = 0;
+        m_reloaded = false;
+    }
+
+    void notificationData()
+    {
+        QTest::addColumn<int>("count");
+
+        QTest::newRow("10") << 10;
+        QTest::newRow("100") << 100;
+        QTest::newRow("1000") << 1000;
+    }
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        EDSBenchmark::initTestCase();
+        QVERIFY(createCollections(1));
+
+        GError *error = 0;
+        m_registry.reset(e_source_registry_new_sync(0, &error));
+        QVERIFY(!error);
+        GScopedPointer<ESource> source(e_source_registry_ref_source(m_registry.data(),
+                                                                    m_collections.first().id().localId().constData()));
+        QVERIFY(!source.isNull());
+        m_client.reset(E_CAL_CLIENT_CONNECT_SYNC(source.data(), E_CAL_CLIENT_SOURCE_TYPE_EVENTS, 0, &error));
+        QVERIFY(!error);
+
+        // a fetch starts watching the collection
+        QOrganizerItemCollectionFilter filter;
+        filter.setCollectionId(m_collections.first().id());
+        QOrganizerManager::Error fetchError;
+        m_engine->items(filter, QDateTime(), QDateTime(), -1,
+                        QList<QOrganizerItemSortOrder>(), QOrganizerItemFetchHint(), &fetchError);
+
+        connect(m_engine, &QOrganizerManagerEngine::itemsAdded,
+                [this](const QList<QOrganizerItemId> &ids) { m_notified += ids.size(); });
+        connect(m_engine, &QOrganizerManagerEngine::itemsRemoved,
+                [this](const QList<QOrganizerItemId> &ids) { m_notified += ids.size(); });
+        // bursts too big to be listed ask the clients to reload everything
+        connect(m_engine, &QOrganizerManagerEngine::dataChanged,
+                [this]() { m_reloaded = true; });
+    }
+
+    void cleanupTestCase()
+    {
+        m_client.reset();
+        m_registry.reset();
+        EDSBenchmark::cleanupTestCase();
+    }
+
+    void benchmarkItemsAdded_data()
+    {
+        notificationData();
+    }
+
+    void benchmarkItemsAdded()
+    {
+        QFETCH(int, count);
+
+        GSList *uids = 0;
+        resetNotifications();
+
+        QElapsedTimer timer;
+        timer.start();
+        QVERIFY(createObjects(count, &uids));
+        bool notified = waitForNotifications(count);
+        QTest::setBenchmarkResult(timer.elapsed(), QTest::WalltimeMilliseconds);
+
+        // let the removals go through before the next row
+        resetNotifications();
+        if (removeObjects(uids)) {
+            waitForNotifications(count);
+        }
+        g_slist_free_full(uids, g_free);
+        QVERIFY(notified);
+    }
+
+    void benchmarkItemsRemoved_data()
+    {
+        notificationData();
+    }
+
+    void benchmarkItemsRemoved()
+    {
+        QFETCH(int, count);
+
+        GSList *uids = 0;
+        resetNotifications();
+        QVERIFY(createObjects(count, &uids));
+        QVERIFY(waitForNotifications(count));
+        resetNotifications();
+
+        QElapsedTimer timer;
+        timer.start();
+        bool removed = removeObjects(uids);
+        bool notified = removed && waitForNotifications(count);
+        QTest::setBenchmarkResult(timer.elapsed(), QTest::WalltimeMilliseconds);
+
+        g_slist_free_full(uids, g_free);
+        QVERIFY(removed);
+        QVERIFY(notified);
+    }
+};
+
+QTEST_MAIN(WatcherBenchmark)
+
+#include "watcher-benchmark.moc"
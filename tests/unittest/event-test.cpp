@@ -23,8 +23,10 @@
 
 #include <QtOrganizer>
 
+#include "config.h"
 #include "qorganizer-eds-engine.h"
 #include "eds-base-test.h"
+#include "gscopedpointer.h"
 
 
 using namespace QtOrganizer;
@@ -642,6 +644,50 @@ private Q_SLOTS:
         QCOMPARE(eventResult.endDateTime().time(), QTime(0, 0, 0));
     }
 
+    void testModifiedDetailTypes()
+    {
+        QDateTime eventDateTime = QDateTime(QDate(2013, 9, 3), QTime(10, 30, 0));
+        QOrganizerEvent event;
+        event.setStartDateTime(eventDateTime);
+        event.setEndDateTime(eventDateTime.addSecs(60 * 60));
+        event.setDisplayLabel(QStringLiteral("Changed details title"));
+        event.setDescription(QStringLiteral("Changed details description"));
+
+        QSignalSpy itemsAdded(m_engine, &QOrganizerManagerEngine::itemsAdded);
+        QtOrganizer::QOrganizerManager::Error error;
+        QMap<int, QtOrganizer::QOrganizerManager::Error> errorMap;
+        QList<QOrganizerItem> items;
+        items << event;
+        bool saveResult = m_engine->saveItems(&items,
+                                              QList<QtOrganizer::QOrganizerItemDetail::DetailType>(),
+                                              &errorMap,
+                                              &error);
+        QVERIFY(saveResult);
+        QTRY_COMPARE(itemsAdded.count(), 1);
+
+        // only the description changes
+        QSignalSpy itemsChanged(m_engine, &QOrganizerManagerEngine::itemsChanged);
+        QOrganizerEvent eventResult = static_cast<QOrganizerEvent>(items[0]);
+        eventResult.setDescription(QStringLiteral("New description"));
+        items.clear();
+        items << eventResult;
+        saveResult = m_engine->saveItems(&items,
+                                         QList<QtOrganizer::QOrganizerItemDetail::DetailType>(),
+                                         &errorMap,
+                                         &error);
+        QVERIFY(saveResult);
+        QTRY_COMPARE(itemsChanged.count(), 1);
+
+        QList<QVariant> args = itemsChanged.takeFirst();
+        QList<QOrganizerItemId> ids = args.at(0).value<QList<QOrganizerItemId> >();
+        QCOMPARE(ids, QList<QOrganizerItemId>() << items[0].id());
+        QList<QOrganizerItemDetail::DetailType> types =
+            args.at(1).value<QList<QOrganizerItemDetail::DetailType> >();
+        QVERIFY(types.contains(QOrganizerItemDetail::TypeDescription));
+        QVERIFY(!types.contains(QOrganizerItemDetail::TypeEventTime));
+        QVERIFY(!types.contains(QOrganizerItemDetail::TypeDisplayLabel));
+    }
+
     void testCreateAllDayEventWithInvalidEndDate()
     {
         static QString displayLabelValue = QStringLiteral("All day title");
@@ -1281,6 +1327,61 @@ private Q_SLOTS:
             QCOMPARE(tags.size(), 0);
         }
    }
+
+    void testWatchCollectionOnFirstUse()
+    {
+        // a real client: the manager connects to every engine signal
+        QOrganizerManager manager("eds");
+        QSignalSpy itemsAdded(&manager, SIGNAL(itemsAdded(QList<QOrganizerItemId>)));
+
+        QOrganizerCollection collection;
+        collection.setMetaData(QOrganizerCollection::KeyName, uniqueCollectionName());
+        QVERIFY(manager.saveCollection(&collection));
+
+        QTRY_COMPARE(manager.collection(collection.id()).id(), collection.id());
+
+        // listening alone does not open the backends
+        QTest::qWait(500);
+        QVERIFY(!m_engine->isWatching(collection.id()));
+
+        // the first fetch on the collection does
+        QOrganizerItemCollectionFilter filter;
+        filter.setCollectionId(collection.id());
+        QCOMPARE(manager.items(filter).size(), 0);
+        QTRY_VERIFY(m_engine->isWatching(collection.id()));
+
+        // create the event with a separate EDS client
+        GError *gError = 0;
+        GScopedPointer<ESourceRegistry> registry(e_source_registry_new_sync(0, &gError));
+        QVERIFY(!gError);
+        GScopedPointer<ESource> source(e_source_registry_ref_source(registry.data(),
+                                                                    collection.id().localId().constData()));
+        QVERIFY(!source.isNull());
+        GScopedPointer<EClient> client(E_CAL_CLIENT_CONNECT_SYNC(source.data(),
+                                                                 E_CAL_CLIENT_SOURCE_TYPE_EVENTS,
+                                                                 0,
+                                                                 &gError));
+        QVERIFY(!gError);
+
+        icaltimetype start = icaltime_from_timet_with_zone(QDateTime::currentDateTime().toTime_t(),
+                                                           0,
+                                                           icaltimezone_get_utc_timezone());
+        icalcomponent *comp = icalcomponent_new(ICAL_VEVENT_COMPONENT);
+        icalcomponent_set_summary(comp, "External event");
+        icalcomponent_set_dtstart(comp, start);
+        icalcomponent_set_dtend(comp, icaltime_add(start, icaldurationtype_from_int(60 * 30)));
+        gchar *uid = 0;
+        e_cal_client_create_object_sync(E_CAL_CLIENT(client.data()), comp, &uid, 0, &gError);
+        icalcomponent_free(comp);
+        QVERIFY(!gError);
+        QByteArray eventUid(uid);
+        g_free(uid);
+
+        QTRY_COMPARE(itemsAdded.count(), 1);
+        QList<QOrganizerItemId> ids = itemsAdded.first().first().value<QList<QOrganizerItemId> >();
+        QCOMPARE(ids.size(), 1);
+        QVERIFY(ids.first().localId().endsWith(eventUid));
+    }
 };
 
 const QString EventTest::collectionTypePropertyName = QStringLiteral("collection-type");
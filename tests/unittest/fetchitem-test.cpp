@@ -30,6 +30,29 @@
 
 using namespace QtOrganizer;
 
+class FetchItemThread : public QThread
+{
+public:
+    FetchItemThread(QOrganizerEDSEngine *engine)
+        : m_engine(engine),
+          m_error(QOrganizerManager::UnspecifiedError)
+    {
+    }
+
+    QOrganizerEDSEngine *m_engine;
+    QOrganizerManager::Error m_error;
+    QList<QOrganizerItem> m_items;
+
+protected:
+    void run()
+    {
+        QOrganizerItemFilter filter;
+        QOrganizerItemFetchHint hint;
+        QList<QOrganizerItemSortOrder> sort;
+        m_items = m_engine->items(filter, QDateTime(), QDateTime(), 100, sort, hint, &m_error);
+    }
+};
+
 class FetchItemTest : public QObject, public EDSBaseTest
 {
     Q_OBJECT
@@ -171,6 +194,181 @@ private Q_SLOTS:
         QList<QOrganizerItem> result = m_engine->items(filter, QDateTime(), QDateTime(), 100, sort, hint, &error);
         QCOMPARE(result.size(), 10);
     }
+
+    void testFetchOverlappingRanges()
+    {
+        QOrganizerItemFilter filter;
+        QOrganizerItemFetchHint hint;
+        QOrganizerManager::Error error;
+        QList<QOrganizerItemSortOrder> sort;
+
+        QDateTime start = QOrganizerEvent(m_events[0]).startDateTime().addSecs(-60*60);
+        QList<QOrganizerItem> result = m_engine->items(filter, start, start.addDays(5), 100, sort, hint, &error);
+        QCOMPARE(error, QOrganizerManager::NoError);
+        QCOMPARE(result.size(), 5);
+
+        // the new range shares three days with the previous one
+        result = m_engine->items(filter, start.addDays(2), start.addDays(8), 100, sort, hint, &error);
+        QCOMPARE(error, QOrganizerManager::NoError);
+        QCOMPARE(result.size(), 6);
+        QSet<QOrganizerItemId> ids;
+        Q_FOREACH(const QOrganizerItem &item, result) {
+            ids << item.id();
+        }
+        for (int i = 2; i < 8; i++) {
+            QVERIFY(ids.contains(m_events[i].id()));
+        }
+
+        // changes are visible in the ranges fetched before
+        QOrganizerItem changed = m_events[3];
+        changed.setDisplayLabel(QStringLiteral("Changed event"));
+        QList<QOrganizerItem> evs;
+        evs << changed;
+        QMap<int, QOrganizerManager::Error> errorMap;
+        QVERIFY(m_engine->saveItems(&evs,
+                                    QList<QOrganizerItemDetail::DetailType>(),
+                                    &errorMap,
+                                    &error));
+        result = m_engine->items(filter, start.addDays(3), start.addDays(4), 100, sort, hint, &error);
+        QCOMPARE(result.size(), 1);
+        QCOMPARE(result[0].displayLabel(), QStringLiteral("Changed event"));
+    }
+
+    void testFetchFreeBusy()
+    {
+        QOrganizerItemCollectionFilter filter;
+        filter.setCollectionId(m_collection.id());
+        QOrganizerItemFetchHint hint;
+        hint.setDetailTypesHint(QList<QOrganizerItemDetail::DetailType>() << QOrganizerItemDetail::TypeEventTime);
+        QOrganizerManager::Error error;
+        QList<QOrganizerItemSortOrder> sort;
+        QDateTime start = QOrganizerEvent(m_events[0]).startDateTime().addSecs(-60*60);
+
+        // without the parameter the events are fetched as usual
+        QList<QOrganizerItem> result = m_engine->items(filter, start, start.addDays(3), 100, sort, hint, &error);
+        QCOMPARE(error, QOrganizerManager::NoError);
+        QCOMPARE(result.size(), 3);
+        Q_FOREACH(const QOrganizerItem &item, result) {
+            QVERIFY(!item.id().isNull());
+        }
+
+        QMap<QString, QString> parameters;
+        parameters.insert(EDS_FREE_BUSY_PARAMETER, QStringLiteral("true"));
+        QOrganizerEDSEngine *engine = QOrganizerEDSEngine::createEDSEngine(parameters);
+
+        result = engine->items(filter, start, start.addDays(3), 100, sort, hint, &error);
+        QCOMPARE(error, QOrganizerManager::NoError);
+        QCOMPARE(result.size(), 3);
+
+        // one period per busy block, the events are not built
+        Q_FOREACH(const QOrganizerItem &item, result) {
+            QOrganizerEvent period(item);
+            QVERIFY(period.id().isNull());
+            QCOMPARE(period.collectionId(), m_collection.id());
+            QCOMPARE(period.startDateTime().secsTo(period.endDateTime()), qint64(60*30));
+        }
+
+        // the request limits apply to the periods
+        result = engine->items(filter, start, start.addDays(3), 2, sort, hint, &error);
+        QCOMPARE(result.size(), 2);
+
+        QOrganizerItemCollectionFilter otherCollection;
+        otherCollection.setCollectionId(QOrganizerCollectionId(m_collection.id().managerUri(), "other"));
+        QOrganizerItemIntersectionFilter both;
+        both << filter << otherCollection;
+        result = engine->items(both, start, start.addDays(3), 100, sort, hint, &error);
+        QCOMPARE(result.size(), 0);
+
+        delete engine;
+    }
+
+    void testFetchFromThread()
+    {
+        FetchItemThread thread(m_engine);
+        thread.start();
+        QTRY_VERIFY(thread.isFinished());
+
+        QCOMPARE(thread.m_error, QOrganizerManager::NoError);
+        QCOMPARE(thread.m_items.size(), 10);
+    }
+
+    void testSharedFetch()
+    {
+        QOrganizerItemFetchRequest first;
+        QOrganizerItemFetchRequest second;
+        QOrganizerItemFetchRequest third;
+
+        m_engine->startRequest(&first);
+        m_engine->startRequest(&second);
+        m_engine->startRequest(&third);
+
+        // the other requests keep waiting for the shared results
+        m_engine->cancelRequest(&first);
+        QCOMPARE(first.state(), QOrganizerAbstractRequest::CanceledState);
+
+        m_engine->waitForRequestFinished(&second, 0);
+        m_engine->waitForRequestFinished(&third, 0);
+
+        QCOMPARE(second.state(), QOrganizerAbstractRequest::FinishedState);
+        QCOMPARE(second.error(), QOrganizerManager::NoError);
+        QCOMPARE(second.items().size(), 10);
+        QCOMPARE(third.state(), QOrganizerAbstractRequest::FinishedState);
+        QCOMPARE(third.items(), second.items());
+    }
+
+    void testCachedFetch()
+    {
+        QOrganizerItemFetchRequest first;
+        m_engine->startRequest(&first);
+        m_engine->waitForRequestFinished(&first, 0);
+        QCOMPARE(first.items().size(), 10);
+
+        // the cached results are delivered later, like the fetched ones
+        QOrganizerItemFetchRequest second;
+        m_engine->startRequest(&second);
+        QCOMPARE(second.state(), QOrganizerAbstractRequest::ActiveState);
+        m_engine->waitForRequestFinished(&second, 0);
+        QCOMPARE(second.state(), QOrganizerAbstractRequest::FinishedState);
+        QCOMPARE(second.items(), first.items());
+    }
+
+    void testFetchSharedBetweenEngines()
+    {
+        QOrganizerEDSEngine *engine = QOrganizerEDSEngine::createEDSEngine(QMap<QString, QString>());
+
+        QOrganizerItemFetchRequest first;
+        QOrganizerItemFetchRequest second;
+        m_engine->startRequest(&first);
+        engine->startRequest(&second);
+
+        m_engine->waitForRequestFinished(&first, 0);
+        engine->waitForRequestFinished(&second, 0);
+        QCOMPARE(first.items().size(), 10);
+        QCOMPARE(second.items(), first.items());
+
+        // writes are visible right away through any engine
+        QOrganizerEvent ev;
+        ev.setCollectionId(m_collection.id());
+        ev.setStartDateTime(QDateTime::currentDateTime());
+        ev.setEndDateTime(QDateTime::currentDateTime().addSecs(60*30));
+        ev.setDisplayLabel(QStringLiteral("Shared fetch event"));
+        QList<QOrganizerItem> evs;
+        evs << ev;
+        QMap<int, QOrganizerManager::Error> errorMap;
+        QOrganizerManager::Error error;
+        QVERIFY(m_engine->saveItems(&evs,
+                                    QList<QOrganizerItemDetail::DetailType>(),
+                                    &errorMap,
+                                    &error));
+
+        QOrganizerItemFetchRequest third;
+        engine->startRequest(&third);
+        engine->waitForRequestFinished(&third, 0);
+        QCOMPARE(third.items().size(), 11);
+
+        QVERIFY(m_engine->removeItems(QList<QOrganizerItemId>() << evs[0].id(), &errorMap, &error));
+        delete engine;
+    }
 };
 
 QTEST_MAIN(FetchItemTest)
@@ -0,0 +1,164 @@
+/*
+ * Copyright 2015 Canonical Ltd.
+ *
+ * This file is part of qtorganizer5-eds.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "qorganizer-eds-intervalindex.h"
+
+#include <QObject>
+#include <QtTest>
+#include <QDebug>
+
+typedef IntervalIndex<int> Index;
+
+class IntervalIndexTest : public QObject
+{
+    Q_OBJECT
+private:
+    static QList<int> values(const QList<Index::Entry> &entries)
+    {
+        QList<int> result;
+        Q_FOREACH(const Index::Entry &entry, entries) {
+            result << entry.value;
+        }
+        qSort(result);
+        return result;
+    }
+
+private Q_SLOTS:
+    void testOverlapping()
+    {
+        Index index;
+        index.insert(10, 20, 1);
+        index.insert(0, 100, 2);
+        index.insert(30, 40, 3);
+        index.insert(50, 50, 4);
+
+        QCOMPARE(values(index.overlapping(0, 10)), QList<int>() << 2);
+        QCOMPARE(values(index.overlapping(15, 35)), QList<int>() << 1 << 2 << 3);
+        QCOMPARE(values(index.overlapping(20, 30)), QList<int>() << 2);
+        QCOMPARE(values(index.overlapping(100, 200)), QList<int>());
+
+        // points belong to the range starting at them only
+        QCOMPARE(values(index.overlapping(50, 51)), QList<int>() << 2 << 4);
+        QCOMPARE(values(index.overlapping(40, 50)), QList<int>() << 2);
+    }
+
+    void testRemove()
+    {
+        Index index;
+        index.insert(0, 100, 1);
+        index.insert(10, 20, 2);
+        index.insert(30, 40, 3);
+
+        int removed = index.removeIf([](const Index::Entry &entry) {
+            return entry.value == 1;
+        });
+        QCOMPARE(removed, 1);
+        QCOMPARE(index.size(), 2);
+
+        // the long entry does not keep the running end up anymore
+        QCOMPARE(values(index.overlapping(25, 28)), QList<int>());
+        QCOMPARE(values(index.overlapping(15, 35)), QList<int>() << 2 << 3);
+    }
+
+    void testContainsAt()
+    {
+        Index index;
+        index.insert(10, 20, 1);
+        index.insert(10, 30, 2);
+        index.insert(20, 30, 3);
+
+        QVERIFY(index.containsAt(10, [](const Index::Entry &entry) { return entry.value == 2; }));
+        QVERIFY(!index.containsAt(10, [](const Index::Entry &entry) { return entry.value == 3; }));
+        QVERIFY(index.containsAt(20, [](const Index::Entry &entry) { return entry.value == 3; }));
+    }
+
+    void testBulkInsert()
+    {
+        qsrand(7);
+        Index single;
+        Index bulk;
+        for (int round = 0; round < 5; round++) {
+            QVector<Index::Entry> entries;
+            for (int i = 0; i < 500; i++) {
+                Index::Entry entry;
+                entry.start = qrand() % 10000;
+                entry.end = entry.start + qrand() % 300;
+                entry.value = round * 1000 + i;
+                single.insert(entry.start, entry.end, entry.value);
+                entries << entry;
+            }
+            bulk.insert(entries);
+
+            // same order as inserting one by one, equal starts included
+            QCOMPARE(bulk.size(), single.size());
+            for (int i = 0; i < single.size(); i++) {
+                QCOMPARE(bulk.entries().at(i).start, single.entries().at(i).start);
+                QCOMPARE(bulk.entries().at(i).value, single.entries().at(i).value);
+            }
+
+            time_t start = qrand() % 10000;
+            QCOMPARE(values(bulk.overlapping(start, start + 200)),
+                     values(single.overlapping(start, start + 200)));
+        }
+
+        bulk.insert(QVector<Index::Entry>());
+        QCOMPARE(bulk.size(), single.size());
+    }
+
+    void testRandomRanges()
+    {
+        qsrand(42);
+        Index index;
+        QList<Index::Entry> all;
+        for (int i = 0; i < 2000; i++) {
+            Index::Entry entry;
+            entry.start = qrand() % 10000;
+            entry.end = entry.start + (qrand() % 4 ? qrand() % 50 : qrand() % 2000);
+            entry.value = i;
+            index.insert(entry.start, entry.end, entry.value);
+            all << entry;
+
+            // updates between queries
+            if ((i % 100) == 99) {
+                int value = qrand() % i;
+                index.removeIf([value](const Index::Entry &e) { return e.value == value; });
+                for (int j = 0; j < all.size(); j++) {
+                    if (all[j].value == value) {
+                        all.removeAt(j);
+                        break;
+                    }
+                }
+            }
+
+            time_t start = qrand() % 10000;
+            time_t end = start + qrand() % 500;
+            QList<int> expected;
+            Q_FOREACH(const Index::Entry &e, all) {
+                if (Index::overlaps(e.start, e.end, start, end)) {
+                    expected << e.value;
+                }
+            }
+            qSort(expected);
+            QCOMPARE(values(index.overlapping(start, end)), expected);
+        }
+    }
+};
+
+QTEST_MAIN(IntervalIndexTest)
+
+#include "intervalindex-test.moc"
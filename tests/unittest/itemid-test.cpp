@@ -0,0 +1,113 @@
+/*
+ * Copyright 2015 Canonical Ltd.
+ *
+ * This file is part of qtorganizer5-eds.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//ugly hack but this allow us to test the engine without mock EDS
+#define private public
+#include "qorganizer-eds-engine.h"
+#undef private
+
+#include "qorganizer-eds-itemidpool.h"
+
+#include <QObject>
+#include <QtTest>
+#include <QDebug>
+
+#include <QtOrganizer>
+
+using namespace QtOrganizer;
+
+#define ITEM_COUNT  100000
+
+class ItemIdTest : public QObject
+{
+    Q_OBJECT
+private:
+    QOrganizerCollectionId m_collectionId;
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        m_collectionId = QOrganizerCollectionId(QStringLiteral("qtorganizer:eds:"),
+                                                QByteArray("1234567890.1234.5678@source"));
+    }
+
+    void testRoundTrip_data()
+    {
+        QTest::addColumn<QByteArray>("uid");
+
+        QTest::newRow("plain") << QByteArray("20150408T215243Z-19265-1000-5926-24@host");
+        QTest::newRow("slash") << QByteArray("https://calendar.example.com/events/42");
+        QTest::newRow("recurrence") << QByteArray("20150408T215243Z-19265@host#20150409T190000Z");
+    }
+
+    void testRoundTrip()
+    {
+        QFETCH(QByteArray, uid);
+
+        QOrganizerItemId id = QOrganizerEDSEngine::idFromEds(m_collectionId, uid);
+        QCOMPARE(id.managerUri(), m_collectionId.managerUri());
+        QCOMPARE(id.localId(), m_collectionId.localId() + '/' + uid);
+
+        QByteArray sourceId;
+        QCOMPARE(QOrganizerEDSEngine::idToEds(id, &sourceId), uid);
+        QCOMPARE(sourceId, m_collectionId.localId());
+    }
+
+    void testComponentId()
+    {
+        QByteArray rid;
+        QCOMPARE(QOrganizerEDSEngine::toComponentId("https://example.com/1", &rid),
+                 QByteArray("https://example.com/1"));
+        QVERIFY(rid.isEmpty());
+
+        QCOMPARE(QOrganizerEDSEngine::toComponentId("https://example.com/1#20150409T190000Z", &rid),
+                 QByteArray("https://example.com/1"));
+        QCOMPARE(rid, QByteArray("20150409T190000Z"));
+    }
+
+    void testInterned()
+    {
+        QOrganizerItemId id = QOrganizerEDSEngine::idFromEds(m_collectionId, "interned@host");
+        QOrganizerItemId other = QOrganizerEDSEngine::idFromEds(m_collectionId, "interned@host");
+        QCOMPARE(id, other);
+        // both ids share the pooled buffer
+        QCOMPARE(id.localId().constData(), other.localId().constData());
+    }
+
+    void benchmarkIdChurn()
+    {
+        QVector<QByteArray> uids;
+        uids.reserve(ITEM_COUNT);
+        for (int i = 0; i < ITEM_COUNT; i++) {
+            uids << QByteArray("20150408T215243Z-19265-1000-5926-") + QByteArray::number(i) + "@host";
+        }
+        ItemIdPool::clear();
+
+        QBENCHMARK {
+            Q_FOREACH(const QByteArray &uid, uids) {
+                QOrganizerItemId id = QOrganizerEDSEngine::idFromEds(m_collectionId, uid);
+                QByteArray sourceId;
+                QOrganizerEDSEngine::idToEds(id, &sourceId);
+            }
+        }
+    }
+};
+
+QTEST_MAIN(ItemIdTest)
+
+#include "itemid-test.moc"
@@ -80,6 +80,38 @@ private Q_SLOTS:
         QCOMPARE(item.endDateTime().toTime_t(), endTime.toTime_t());
     }
 
+    void benchmarkFromIcalTime_data()
+    {
+        QTest::addColumn<QByteArray>("time");
+        QTest::addColumn<QByteArray>("tzId");
+        QTest::addColumn<QDateTime>("expected");
+
+        QTest::newRow("utc") << QByteArray("20150408T220000Z") << QByteArray("UTC")
+                             << QDateTime(QDate(2015, 4, 8), QTime(22, 0, 0), Qt::UTC);
+        QTest::newRow("zone") << QByteArray("20150408T190000")
+                              << QByteArray("/freeassociation.sourceforge.net/Tzfile/America/Recife")
+                              << QDateTime(QDate(2015, 4, 8), QTime(19, 0, 0), QTimeZone("America/Recife"));
+        QTest::newRow("floating") << QByteArray("20150408T190000") << QByteArray()
+                                  << QDateTime(QDate(2015, 4, 8), QTime(19, 0, 0), Qt::UTC);
+        QTest::newRow("all day") << QByteArray("20150408") << QByteArray()
+                                 << QDateTime(QDate(2015, 4, 8), QTime(0, 0, 0), QTimeZone(QTimeZone::systemTimeZoneId()));
+    }
+
+    void benchmarkFromIcalTime()
+    {
+        QFETCH(QByteArray, time);
+        QFETCH(QByteArray, tzId);
+        QFETCH(QDateTime, expected);
+
+        struct icaltimetype itt = icaltime_from_string(time.constData());
+        const char *tz = tzId.isEmpty() ? 0 : tzId.constData();
+
+        QCOMPARE(QOrganizerEDSEngine::fromIcalTime(itt, tz), expected);
+        QBENCHMARK {
+            QOrganizerEDSEngine::fromIcalTime(itt, tz);
+        }
+    }
+
     void testParseRemindersQOrganizerEvent2ECalComponent()
     {
         QOrganizerEvent event;
@@ -417,6 +449,45 @@ private Q_SLOTS:
         g_slist_free_full(events, (GDestroyNotify)icalcomponent_free);
         delete engine;
     }
+
+    void testParsePlan()
+    {
+        icalcomponent *ical = icalcomponent_new_from_string(vEvent.toUtf8().data());
+        QVERIFY(ical);
+        GSList *events = g_slist_append(NULL, ical);
+        QOrganizerCollectionId collectionId(QStringLiteral("qtorganizer:eds::"), QByteArray("source"));
+
+        // a list view only needs the label and the times
+        QList<QOrganizerItemDetail::DetailType> detailsHint;
+        detailsHint << QOrganizerItemDetail::TypeDisplayLabel
+                    << QOrganizerItemDetail::TypeEventTime;
+        ParsePlan plan(detailsHint);
+
+        QList<QOrganizerItem> items = QOrganizerEDSEngine::parseEvents(collectionId, events, true, plan);
+        QCOMPARE(items.size(), 1);
+        QOrganizerEvent ev = items.at(0);
+        QVERIFY(!ev.id().isNull());
+        QCOMPARE(ev.collectionId(), collectionId);
+        QCOMPARE(ev.displayLabel(), QStringLiteral("one minute after start"));
+        QDateTime eventTime(QDate(2015,04, 8), QTime(19, 0, 0), QTimeZone("America/Recife"));
+        QCOMPARE(ev.startDateTime(), eventTime);
+        QCOMPARE(ev.endDateTime(), eventTime.addSecs(30 * 60));
+        QVERIFY(ev.description().isEmpty());
+        QVERIFY(ev.details(QOrganizerItemDetail::TypeRecurrence).isEmpty());
+        QVERIFY(ev.details(QOrganizerItemDetail::TypeVisualReminder).isEmpty());
+
+        // an empty hint still parses everything
+        ParsePlan fullPlan;
+        items = QOrganizerEDSEngine::parseEvents(collectionId, events, true, fullPlan);
+        QCOMPARE(items.size(), 1);
+        ev = items.at(0);
+        QCOMPARE(ev.description(), QStringLiteral("event to parse"));
+        QCOMPARE(ev.recurrenceRule().frequency(), QOrganizerRecurrenceRule::Daily);
+        QOrganizerItemVisualReminder vreminder = ev.detail(QOrganizerItemDetail::TypeVisualReminder);
+        QCOMPARE(vreminder.secondsBeforeStart(), 60);
+
+        g_slist_free_full(events, (GDestroyNotify)icalcomponent_free);
+    }
 };
 
 const QString ParseEcalTest::vEvent = QStringLiteral(""